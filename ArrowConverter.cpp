@@ -0,0 +1,599 @@
+#include "ArrowConverter.h"
+#include "NumberFormat.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+
+namespace {
+
+//values of enums and unions of the Arrow format (Schema.fbs, Message.fbs)
+constexpr int16_t METADATA_V5 = 4;
+constexpr uint8_t HEADER_SCHEMA = 1;
+constexpr uint8_t HEADER_RECORD_BATCH = 3;
+constexpr uint8_t TYPE_INT = 2;
+constexpr uint8_t TYPE_FLOATING_POINT = 3;
+constexpr uint8_t TYPE_BINARY = 4;
+constexpr uint8_t TYPE_UTF8 = 5;
+constexpr uint8_t TYPE_BOOL = 6;
+constexpr uint8_t TYPE_TIMESTAMP = 10;
+constexpr int16_t PRECISION_SINGLE = 1;
+constexpr int16_t PRECISION_DOUBLE = 2;
+constexpr int16_t UNIT_MILLISECOND = 1;
+
+//marker of IPC message
+constexpr uint32_t CONTINUATION = 0xFFFFFFFF;
+
+/**
+ * Builder of flatbuffers
+ *
+ * Like the reference implementation, the buffer is built back to front, so
+ * referenced objects (strings, vectors, tables) are created before the
+ * table referring them. Positions are counted from the end of the buffer.
+ */
+class FlatBuilder final {
+private:
+    //content is at the end of the vector
+    std::vector<uint8_t> buf;
+    size_t used = 0;
+    //fields (slot, position) of the table in progress
+    std::vector<std::pair<uint16_t, uint32_t>> fields;
+    uint32_t tableStart = 0;
+
+    uint8_t *grow(size_t size) {
+        if (used + size > buf.size()) {
+            std::vector<uint8_t> next(std::max(buf.size() * 2,
+                                               std::max<size_t>(used + size,
+                                                                256)));
+            if (used > 0) {
+                memcpy(next.data() + next.size() - used,
+                       buf.data() + buf.size() - used, used);
+            }
+            buf.swap(next);
+        }
+        used += size;
+        return buf.data() + buf.size() - used;
+    }
+
+    void pad(size_t size) {
+        if (size > 0) {
+            memset(grow(size), 0, size);
+        }
+    }
+
+    //align so that the next `additional` bytes end aligned
+    void prep(size_t align, size_t additional) {
+        pad((align - (used + additional) % align) % align);
+    }
+
+public:
+    template<typename T>
+    void push(T value) {
+        prep(sizeof(T), 0);
+        uint8_t *out = grow(sizeof(T));
+        for (size_t i = 0; i < sizeof(T); i++) {
+            out[i] = uint8_t(uint64_t(value) >> (8 * i));
+        }
+    }
+
+    void pushOffset(uint32_t target) {
+        prep(4, 0);
+        push<uint32_t>(used + 4 - target);
+    }
+
+    uint32_t string(const std::string &text) {
+        prep(4, text.size() + 1);
+        pad(1);
+        memcpy(grow(text.size()), text.data(), text.size());
+        push<uint32_t>(text.size());
+        return used;
+    }
+
+    uint32_t offsets(const std::vector<uint32_t> &items) {
+        prep(4, 4 * items.size());
+        for (size_t i = items.size(); i > 0; i--) {
+            pushOffset(items[i - 1]);
+        }
+        push<uint32_t>(items.size());
+        return used;
+    }
+
+    //vector of structs with two longs (FieldNode, Buffer)
+    uint32_t pairs(const std::vector<std::pair<int64_t, int64_t>> &items) {
+        prep(8, 16 * items.size());
+        for (size_t i = items.size(); i > 0; i--) {
+            push<int64_t>(items[i - 1].second);
+            push<int64_t>(items[i - 1].first);
+        }
+        push<uint32_t>(items.size());
+        return used;
+    }
+
+    void startTable() {
+        fields.clear();
+        tableStart = used;
+    }
+
+    template<typename T>
+    void add(uint16_t slot, T value) {
+        push<T>(value);
+        fields.emplace_back(slot, used);
+    }
+
+    void addOffset(uint16_t slot, uint32_t target) {
+        pushOffset(target);
+        fields.emplace_back(slot, used);
+    }
+
+    uint32_t endTable() {
+        push<int32_t>(0);
+        const uint32_t table = used;
+
+        uint16_t slots = 0;
+        for (const auto &field : fields) {
+            slots = std::max<uint16_t>(slots, field.first + 1);
+        }
+        std::vector<uint16_t> vtable(slots, 0);
+        for (const auto &field : fields) {
+            vtable[field.first] = table - field.second;
+        }
+        for (size_t i = slots; i > 0; i--) {
+            push<uint16_t>(vtable[i - 1]);
+        }
+        push<uint16_t>(table - tableStart);
+        push<uint16_t>((slots + 2) * 2);
+
+        //table refers its vtable by signed offset
+        const int32_t offset = int32_t(used) - int32_t(table);
+        uint8_t *out = buf.data() + buf.size() - table;
+        for (size_t i = 0; i < 4; i++) {
+            out[i] = uint8_t(uint32_t(offset) >> (8 * i));
+        }
+        return table;
+    }
+
+    std::string finish(uint32_t root) {
+        prep(8, 4);
+        pushOffset(root);
+        return std::string(reinterpret_cast<const char *>(buf.data() +
+                                                          buf.size() - used),
+                           used);
+    }
+};
+
+inline void appendLittleEndian(std::vector<uint8_t> &out, uint64_t value,
+                               size_t width) {
+    for (size_t i = 0; i < width; i++) {
+        out.push_back(uint8_t(value >> (8 * i)));
+    }
+}
+
+inline uint8_t *writeLittleEndian(uint32_t value, uint8_t *out) {
+    for (size_t i = 0; i < 4; i++) {
+        *out++ = uint8_t(value >> (8 * i));
+    }
+    return out;
+}
+
+inline size_t padded(size_t size) {
+    return (size + 7) & ~size_t(7);
+}
+
+/**
+ * Append value of the field to the column
+ * @return false if the value is invalid (null)
+ */
+bool appendValue(const ArrowSchema::Column &column, const uint8_t *data,
+                 uint16_t size, uint32_t row, ArrowBatch::Column &out) {
+    switch (column.type) {
+        case ArrowSchema::Type::UINT:
+            if (size < 1 || size > 8) {
+                appendLittleEndian(out.values, 0, column.width);
+                return false;
+            }
+            appendLittleEndian(out.values,
+                               NumberFormat::readUintBe(data, size),
+                               column.width);
+            return true;
+        case ArrowSchema::Type::INT:
+            if (size < 1 || size > 8) {
+                appendLittleEndian(out.values, 0, column.width);
+                return false;
+            }
+            appendLittleEndian(out.values,
+                               NumberFormat::readIntBe(data, size),
+                               column.width);
+            return true;
+        case ArrowSchema::Type::FLOAT:
+            if (size != 4) {
+                appendLittleEndian(out.values, 0, 4);
+                return false;
+            }
+            appendLittleEndian(out.values, NumberFormat::readUintBe(data, 4),
+                               4);
+            return true;
+        case ArrowSchema::Type::DOUBLE: {
+            double value;
+            if (fds_get_float_be(data, size, &value) != FDS_OK) {
+                appendLittleEndian(out.values, 0, 8);
+                return false;
+            }
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            appendLittleEndian(out.values, bits, 8);
+            return true;
+        }
+        case ArrowSchema::Type::BOOL:
+            if (row % 8 == 0) {
+                out.values.push_back(0);
+            }
+            //IPFIX true is 1, false is 2
+            if (size != 1 || (data[0] != 1 && data[0] != 2)) {
+                return false;
+            }
+            if (data[0] == 1) {
+                out.values.back() |= uint8_t(1U << (row % 8));
+            }
+            return true;
+        case ArrowSchema::Type::TIMESTAMP: {
+            uint64_t value;
+            if (fds_get_datetime_lp_be(data, size, column.dataType, &value) !=
+                FDS_OK) {
+                appendLittleEndian(out.values, 0, 8);
+                return false;
+            }
+            appendLittleEndian(out.values, value, 8);
+            return true;
+        }
+        case ArrowSchema::Type::BINARY:
+        case ArrowSchema::Type::UTF8:
+            out.values.insert(out.values.end(), data, data + size);
+            appendLittleEndian(out.offsets, out.values.size(), 4);
+            return true;
+    }
+    return false;
+}
+
+} // namespace
+
+ArrowConverter::ArrowConverter(
+        std::shared_ptr<ConfigFormat> configFormat,
+        std::shared_ptr<ConfigProcessing> configProcessing)
+        : RecordConverter(configFormat) {
+    this->configProcessing = configProcessing;
+}
+
+std::string ArrowConverter::columnName(const fds_tfield &tfield) const {
+    const fds_iemgr_elem *def = tfield.def;
+    if (def == nullptr || configFormat->numeric_names) {
+        return "en" + std::to_string(tfield.en) + ":id" +
+               std::to_string(tfield.id);
+    }
+    return std::string(def->scope->name) + ":" + def->name;
+}
+
+std::unique_ptr<ArrowSchema>
+ArrowConverter::compile(const fds_template *tmplt) const {
+    std::unique_ptr<ArrowSchema> schema = std::make_unique<ArrowSchema>();
+    schema->dynamic = (tmplt->flags & FDS_TEMPLATE_DYNAMIC) != 0;
+
+    FlatBuilder builder;
+    std::vector<uint32_t> fields;
+    std::unordered_set<std::string> names;
+    for (uint16_t i = 0; i < tmplt->fields_cnt_total; i++) {
+        const fds_tfield &tfield = tmplt->fields[i];
+        const fds_iemgr_elem *def = tfield.def;
+        if (tfield.en == 0 && tfield.id == 210) {
+            //paddingOctets
+            continue;
+        }
+        if (def == nullptr && configFormat->ignore_unknown) {
+            continue;
+        }
+        if (!isSelected(tfield)) {
+            continue;
+        }
+
+        ArrowSchema::Column column;
+        column.index = i;
+        column.offset = tfield.offset;
+        column.length = tfield.length;
+        column.dataType = def ? def->data_type : FDS_ET_OCTET_ARRAY;
+        column.width = 0;
+        switch (column.dataType) {
+            case FDS_ET_UNSIGNED_8:
+            case FDS_ET_UNSIGNED_16:
+            case FDS_ET_UNSIGNED_32:
+            case FDS_ET_UNSIGNED_64:
+                column.type = ArrowSchema::Type::UINT;
+                column.width = 1U << (column.dataType - FDS_ET_UNSIGNED_8);
+                break;
+            case FDS_ET_SIGNED_8:
+            case FDS_ET_SIGNED_16:
+            case FDS_ET_SIGNED_32:
+            case FDS_ET_SIGNED_64:
+                column.type = ArrowSchema::Type::INT;
+                column.width = 1U << (column.dataType - FDS_ET_SIGNED_8);
+                break;
+            case FDS_ET_FLOAT_32:
+                column.type = ArrowSchema::Type::FLOAT;
+                column.width = 4;
+                break;
+            case FDS_ET_FLOAT_64:
+                column.type = ArrowSchema::Type::DOUBLE;
+                column.width = 8;
+                break;
+            case FDS_ET_BOOLEAN:
+                column.type = ArrowSchema::Type::BOOL;
+                break;
+            case FDS_ET_DATE_TIME_SECONDS:
+            case FDS_ET_DATE_TIME_MILLISECONDS:
+            case FDS_ET_DATE_TIME_MICROSECONDS:
+            case FDS_ET_DATE_TIME_NANOSECONDS:
+                column.type = ArrowSchema::Type::TIMESTAMP;
+                column.width = 8;
+                break;
+            case FDS_ET_STRING:
+                column.type = ArrowSchema::Type::UTF8;
+                break;
+            case FDS_ET_OCTET_ARRAY:
+            case FDS_ET_MAC_ADDRESS:
+            case FDS_ET_IPV4_ADDRESS:
+            case FDS_ET_IPV6_ADDRESS:
+                column.type = ArrowSchema::Type::BINARY;
+                break;
+            default:
+                //lists and unassigned types are not encoded
+                continue;
+        }
+
+        //repeated Information Elements get suffix
+        std::string name = columnName(tfield);
+        for (uint32_t n = 2; !names.insert(name).second; n++) {
+            name = columnName(tfield) + "_" + std::to_string(n);
+        }
+
+        //Field {name, nullable, type, children}
+        const uint32_t nameOffset = builder.string(name);
+        const uint32_t children = builder.offsets({});
+        uint32_t timezone = 0;
+        if (column.type == ArrowSchema::Type::TIMESTAMP) {
+            timezone = builder.string("UTC");
+        }
+
+        uint8_t typeId = TYPE_BINARY;
+        builder.startTable();
+        switch (column.type) {
+            case ArrowSchema::Type::UINT:
+            case ArrowSchema::Type::INT:
+                typeId = TYPE_INT;
+                builder.add<int32_t>(0, column.width * 8);
+                builder.add<uint8_t>(1, column.type ==
+                                        ArrowSchema::Type::INT);
+                break;
+            case ArrowSchema::Type::FLOAT:
+                typeId = TYPE_FLOATING_POINT;
+                builder.add<int16_t>(0, PRECISION_SINGLE);
+                break;
+            case ArrowSchema::Type::DOUBLE:
+                typeId = TYPE_FLOATING_POINT;
+                builder.add<int16_t>(0, PRECISION_DOUBLE);
+                break;
+            case ArrowSchema::Type::BOOL:
+                typeId = TYPE_BOOL;
+                break;
+            case ArrowSchema::Type::TIMESTAMP:
+                typeId = TYPE_TIMESTAMP;
+                builder.add<int16_t>(0, UNIT_MILLISECOND);
+                builder.addOffset(1, timezone);
+                break;
+            case ArrowSchema::Type::BINARY:
+                typeId = TYPE_BINARY;
+                break;
+            case ArrowSchema::Type::UTF8:
+                typeId = TYPE_UTF8;
+                break;
+        }
+        const uint32_t type = builder.endTable();
+
+        builder.startTable();
+        builder.addOffset(0, nameOffset);
+        builder.add<uint8_t>(1, 1);
+        builder.add<uint8_t>(2, typeId);
+        builder.addOffset(3, type);
+        builder.addOffset(5, children);
+        fields.push_back(builder.endTable());
+
+        schema->columns.push_back(column);
+    }
+
+    const uint32_t fieldsOffset = builder.offsets(fields);
+    builder.startTable();
+    builder.addOffset(1, fieldsOffset);
+    const uint32_t header = builder.endTable();
+
+    builder.startTable();
+    builder.add<int64_t>(3, 0);
+    builder.addOffset(2, header);
+    builder.add<int16_t>(0, METADATA_V5);
+    builder.add<uint8_t>(1, HEADER_SCHEMA);
+    const std::string metadata = builder.finish(builder.endTable());
+
+    uint8_t prefix[8];
+    writeLittleEndian(metadata.size(), writeLittleEndian(CONTINUATION,
+                                                         prefix));
+    schema->message.assign(reinterpret_cast<const char *>(prefix),
+                           sizeof(prefix));
+    schema->message += metadata;
+    return schema;
+}
+
+void ArrowConverter::append(const ArrowSchema *schema, fds_drec *rec,
+                            ArrowBatch *batch, ConverterState *state) {
+    if (schema->dynamic) {
+        collectFields(rec, state);
+    }
+
+    const uint32_t row = batch->rows;
+    for (size_t i = 0; i < schema->columns.size(); i++) {
+        const ArrowSchema::Column &column = schema->columns[i];
+        ArrowBatch::Column &out = batch->columns[i];
+        const uint8_t *data;
+        uint16_t size;
+        if (schema->dynamic) {
+            data = state->fields[column.index].data;
+            size = state->fields[column.index].size;
+        } else {
+            data = rec->data + column.offset;
+            size = column.length;
+        }
+
+        const size_t before = out.values.size();
+        if (row % 8 == 0) {
+            out.validity.push_back(0);
+        }
+        if (appendValue(column, data, size, row, out)) {
+            out.validity.back() |= uint8_t(1U << (row % 8));
+        } else {
+            out.nulls++;
+            if (column.width == 0 && column.type != ArrowSchema::Type::BOOL) {
+                //empty value keeps the offsets consistent
+                appendLittleEndian(out.offsets, out.values.size(), 4);
+            }
+        }
+        batch->bytes += out.values.size() - before;
+    }
+    batch->rows++;
+}
+
+int ArrowConverter::encode(const ArrowBatch *batch, OutputBuffer *buffer) {
+    const ArrowSchema *schema =
+            static_cast<const ArrowSchema *>(batch->schema.get());
+
+    //layout of the body, every buffer is aligned to 8 bytes
+    std::vector<std::pair<int64_t, int64_t>> nodes;
+    std::vector<std::pair<int64_t, int64_t>> buffers;
+    std::vector<const std::vector<uint8_t> *> parts;
+    int64_t bodyLength = 0;
+    auto addBuffer = [&](const std::vector<uint8_t> &part, size_t length) {
+        buffers.emplace_back(bodyLength, length);
+        parts.push_back(length ? &part : nullptr);
+        bodyLength += padded(length);
+    };
+    for (size_t i = 0; i < schema->columns.size(); i++) {
+        const ArrowBatch::Column &column = batch->columns[i];
+        nodes.emplace_back(batch->rows, column.nulls);
+        //validity bitmap may be omitted without null values
+        addBuffer(column.validity, column.nulls ? column.validity.size() : 0);
+        if (schema->columns[i].width == 0 &&
+            schema->columns[i].type != ArrowSchema::Type::BOOL) {
+            addBuffer(column.offsets, column.offsets.size());
+        }
+        addBuffer(column.values, column.values.size());
+    }
+
+    FlatBuilder builder;
+    const uint32_t buffersOffset = builder.pairs(buffers);
+    const uint32_t nodesOffset = builder.pairs(nodes);
+    builder.startTable();
+    builder.add<int64_t>(0, batch->rows);
+    builder.addOffset(1, nodesOffset);
+    builder.addOffset(2, buffersOffset);
+    const uint32_t header = builder.endTable();
+
+    builder.startTable();
+    builder.add<int64_t>(3, bodyLength);
+    builder.addOffset(2, header);
+    builder.add<int16_t>(0, METADATA_V5);
+    builder.add<uint8_t>(1, HEADER_RECORD_BATCH);
+    const std::string metadata = builder.finish(builder.endTable());
+
+    //Schema message, RecordBatch message, end-of-stream
+    const size_t length = schema->message.size() + 8 + metadata.size() +
+                          bodyLength + 8;
+    if (!buffer->reserve(length)) {
+        return FDS_ERR_NOMEM;
+    }
+    uint8_t *out = reinterpret_cast<uint8_t *>(buffer->data +
+                                               buffer->length);
+    memcpy(out, schema->message.data(), schema->message.size());
+    out += schema->message.size();
+    out = writeLittleEndian(metadata.size(),
+                            writeLittleEndian(CONTINUATION, out));
+    memcpy(out, metadata.data(), metadata.size());
+    out += metadata.size();
+    for (size_t i = 0; i < parts.size(); i++) {
+        const size_t size = buffers[i].second;
+        if (parts[i] != nullptr) {
+            memcpy(out, parts[i]->data(), size);
+        }
+        memset(out + size, 0, padded(size) - size);
+        out += padded(size);
+    }
+    writeLittleEndian(0, writeLittleEndian(CONTINUATION, out));
+
+    buffer->length += length;
+    return length;
+}
+
+int ArrowConverter::convert(const SharedTemplate *shared, fds_drec *rec,
+                            const fds_iemgr_t *iemgr, OutputBuffer *buffer,
+                            ConverterState *state) const {
+    (void) iemgr;
+    std::call_once(shared->planFlag, [this, shared]() {
+        shared->plan = compile(shared->tmplt);
+    });
+    const ArrowSchema *schema =
+            static_cast<const ArrowSchema *>(shared->plan.get());
+
+    std::unique_ptr<PendingBatch> &pending = state->batches[schema];
+    if (!pending) {
+        std::unique_ptr<ArrowBatch> batch = std::make_unique<ArrowBatch>();
+        batch->schema = shared->plan;
+        //records of one template have one topic
+        batch->topic = buffer->topic;
+        batch->columns.resize(schema->columns.size());
+        for (size_t i = 0; i < schema->columns.size(); i++) {
+            batch->columns[i].nulls = 0;
+            if (schema->columns[i].width == 0 &&
+                schema->columns[i].type != ArrowSchema::Type::BOOL) {
+                appendLittleEndian(batch->columns[i].offsets, 0, 4);
+            }
+        }
+        batch->rows = 0;
+        batch->bytes = 0;
+        batch->started = std::chrono::steady_clock::now();
+        pending = std::move(batch);
+    }
+
+    ArrowBatch *batch = static_cast<ArrowBatch *>(pending.get());
+    append(schema, rec, batch, state);
+    if (batch->rows < configProcessing->batchMaxRecords &&
+        batch->bytes < configProcessing->batchMaxBytes) {
+        return 0;
+    }
+
+    const std::unique_ptr<PendingBatch> full = std::move(pending);
+    state->batches.erase(schema);
+    return encode(batch, buffer);
+}
+
+int ArrowConverter::drain(OutputBuffer *buffer, ConverterState *state,
+                          bool all) const {
+    const auto now = std::chrono::steady_clock::now();
+    const auto linger =
+            std::chrono::milliseconds(configProcessing->batchLingerMs);
+    for (auto it = state->batches.begin(); it != state->batches.end(); ++it) {
+        const ArrowBatch *batch = static_cast<const ArrowBatch *>(
+                it->second.get());
+        if (!all && now - batch->started < linger) {
+            continue;
+        }
+        const std::unique_ptr<PendingBatch> expired = std::move(it->second);
+        state->batches.erase(it);
+        buffer->topic = batch->topic;
+        return encode(batch, buffer);
+    }
+    return 0;
+}
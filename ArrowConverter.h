@@ -0,0 +1,154 @@
+#ifndef ARROW_CONVERTER_H
+#define ARROW_CONVERTER_H
+
+#include <ipfixcol2.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "RecordConverter.h"
+
+/**
+ * \brief Arrow schema of one template
+ *
+ * Generated on the first record of the template. Holds the encoded Schema
+ * message, which starts every IPC stream of the template.
+ */
+class ArrowSchema final : public TemplatePlan {
+public:
+    /** Arrow type of column */
+    enum class Type : uint8_t {
+        UINT,      /**< unsigned integer of the width of the IE type       */
+        INT,       /**< signed integer of the width of the IE type         */
+        FLOAT,     /**< float (32 bit)                                     */
+        DOUBLE,    /**< double (64 bit)                                    */
+        BOOL,      /**< boolean (bitmap)                                   */
+        TIMESTAMP, /**< timestamp in milliseconds, UTC (64 bit)            */
+        BINARY,    /**< raw field data (addresses, octet arrays)           */
+        UTF8       /**< string                                             */
+    };
+
+    /** Column of the batch */
+    struct Column {
+        /** index of the field in template                                 */
+        uint16_t index;
+        /** offset of the field in record (static templates only)          */
+        uint16_t offset;
+        /** length of the field (static templates only)                    */
+        uint16_t length;
+        /** Arrow type                                                     */
+        Type type;
+        /** bytes of value (fixed-width types), 0 otherwise                */
+        uint8_t width;
+        /** data type of the field                                         */
+        fds_iemgr_element_type dataType;
+    };
+
+    /** template has variable-length fields                                */
+    bool dynamic;
+    /** encapsulated Schema message                                        */
+    std::string message;
+    /** columns in template order                                          */
+    std::vector<Column> columns;
+};
+
+/**
+ * \brief Records of one template buffered by a conversion thread
+ */
+class ArrowBatch final : public PendingBatch {
+public:
+    /** Buffers of column */
+    struct Column {
+        /** validity bitmap                                                */
+        std::vector<uint8_t> validity;
+        /** values (fixed-width types, bitmap of booleans) or data         */
+        std::vector<uint8_t> values;
+        /** offsets into data (binary and string types, 32 bit)            */
+        std::vector<uint8_t> offsets;
+        /** number of null values                                          */
+        uint32_t nulls;
+    };
+
+    /** schema of the batch, kept alive until the batch is sent            */
+    std::shared_ptr<const TemplatePlan> schema;
+    /** columns of the batch                                               */
+    std::vector<Column> columns;
+    /** number of records                                                  */
+    uint32_t rows;
+    /** bytes of values and data of all columns                            */
+    size_t bytes;
+    /** time of the first record                                           */
+    std::chrono::steady_clock::time_point started;
+};
+
+/**
+ * \brief Converter of IPFIX records to Apache Arrow IPC streams
+ *
+ * Records of each template are buffered per thread as columns (one column
+ * per IE, invalid values are null). A batch is sent as one kafka message
+ * when it reaches the limit of records (batchMaxRecords) or bytes
+ * (batchMaxBytes), or when its first record waits longer than batchLingerMs.
+ * Every message is a complete IPC stream: Schema message, RecordBatch
+ * message and end-of-stream marker. Fields with lists (basicList,
+ * subTemplateList, ...) are not encoded.
+ */
+class ArrowConverter final : public RecordConverter {
+private:
+    std::shared_ptr<ConfigProcessing> configProcessing;
+
+    /**
+     * Generate schema of the template
+     * @param[in] tmplt template
+     * @return schema
+     */
+    std::unique_ptr<ArrowSchema> compile(const fds_template *tmplt) const;
+
+    /**
+     * Name of the column (the same as key in JSON)
+     * @param[in] tfield field of template
+     */
+    std::string columnName(const fds_tfield &tfield) const;
+
+    /**
+     * Append record to the batch
+     * @param[in] schema schema of the batch
+     * @param[in] rec record
+     * @param[in,out] batch batch of the template
+     * @param[in,out] state state of the calling thread
+     */
+    static void append(const ArrowSchema *schema, fds_drec *rec,
+                       ArrowBatch *batch, ConverterState *state);
+
+    /**
+     * Encode the batch as IPC stream
+     * @param[in] batch batch
+     * @param[in,out] buffer output buffer (may grow)
+     * @return number of appended bytes or negative error code
+     */
+    static int encode(const ArrowBatch *batch, OutputBuffer *buffer);
+
+public:
+    /**
+     * \brief Constructor
+     *
+     * @param[in] configFormat configuration of the output format
+     * @param[in] configProcessing configuration plugin (limits of batches)
+     */
+    ArrowConverter(std::shared_ptr<ConfigFormat> configFormat,
+                   std::shared_ptr<ConfigProcessing> configProcessing);
+
+    /**
+     * \brief Append record to the batch of its template
+     * @return number of appended bytes when the batch reached its limit and
+     * was encoded, 0 if the record is buffered, or negative error code
+     */
+    int convert(const SharedTemplate *shared, fds_drec *rec,
+                const fds_iemgr_t *iemgr, OutputBuffer *buffer,
+                ConverterState *state) const override;
+
+    int drain(OutputBuffer *buffer, ConverterState *state,
+              bool all) const override;
+};
+
+#endif // ARROW_CONVERTER_H
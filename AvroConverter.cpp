@@ -0,0 +1,294 @@
+#include "AvroConverter.h"
+#include "Logger.h"
+#include "NumberFormat.h"
+#include <cctype>
+#include <cstring>
+#include <mutex>
+#include <unordered_set>
+
+namespace {
+
+//Confluent wire format: magic byte and schema ID
+constexpr size_t PREFIX_LENGTH = 5;
+//maximal length of zigzag varint
+constexpr size_t MAX_VARINT_LENGTH = 10;
+
+//zigzag varint (Avro int and long)
+inline uint8_t *writeLong(int64_t value, uint8_t *out) {
+    uint64_t zigzag = (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+    while (zigzag >= 0x80) {
+        *out++ = uint8_t(zigzag) | 0x80;
+        zigzag >>= 7;
+    }
+    *out++ = uint8_t(zigzag);
+    return out;
+}
+
+//little-endian bytes
+template<typename T>
+inline uint8_t *writeLittleEndian(T bits, uint8_t *out) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+        *out++ = uint8_t(bits >> (8 * i));
+    }
+    return out;
+}
+
+//length and data (Avro bytes and string)
+inline uint8_t *writeBytes(const uint8_t *data, uint16_t size, uint8_t *out) {
+    out = writeLong(size, out);
+    memcpy(out, data, size);
+    return out + size;
+}
+
+/**
+ * Encode value of the field
+ * @return end of written bytes or nullptr on malformed value
+ */
+uint8_t *encodeValue(const AvroSchema::Field &field, const uint8_t *data,
+                     uint16_t size, uint8_t *out) {
+    switch (field.type) {
+        case AvroSchema::Type::UINT:
+            if (size < 1 || size > 8) {
+                return nullptr;
+            }
+            //values above the range of long wrap around
+            return writeLong(int64_t(NumberFormat::readUintBe(data, size)),
+                             out);
+        case AvroSchema::Type::INT:
+            if (size < 1 || size > 8) {
+                return nullptr;
+            }
+            return writeLong(NumberFormat::readIntBe(data, size), out);
+        case AvroSchema::Type::FLOAT:
+        case AvroSchema::Type::DOUBLE: {
+            double value;
+            if (fds_get_float_be(data, size, &value) != FDS_OK) {
+                return nullptr;
+            }
+            if (field.type == AvroSchema::Type::FLOAT) {
+                const float single = float(value);
+                uint32_t bits;
+                memcpy(&bits, &single, sizeof(bits));
+                return writeLittleEndian(bits, out);
+            }
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return writeLittleEndian(bits, out);
+        }
+        case AvroSchema::Type::BOOLEAN:
+            if (size != 1) {
+                return nullptr;
+            }
+            //IPFIX true is 1, false is 2
+            *out++ = data[0] == 1 ? 1 : 0;
+            return out;
+        case AvroSchema::Type::TIMESTAMP: {
+            uint64_t value;
+            if (fds_get_datetime_lp_be(data, size, field.dataType, &value) !=
+                FDS_OK) {
+                return nullptr;
+            }
+            return writeLong(int64_t(value), out);
+        }
+        case AvroSchema::Type::BYTES:
+        case AvroSchema::Type::STRING:
+            return writeBytes(data, size, out);
+    }
+    return nullptr;
+}
+
+//Avro type of the encoding
+const char *typeName(const AvroSchema::Field &field) {
+    switch (field.type) {
+        case AvroSchema::Type::UINT:
+            return "\"long\"";
+        case AvroSchema::Type::INT:
+            return field.dataType == FDS_ET_SIGNED_64 ? "\"long\"" : "\"int\"";
+        case AvroSchema::Type::FLOAT:
+            return "\"float\"";
+        case AvroSchema::Type::DOUBLE:
+            return "\"double\"";
+        case AvroSchema::Type::BOOLEAN:
+            return "\"boolean\"";
+        case AvroSchema::Type::TIMESTAMP:
+            return "{\"type\":\"long\",\"logicalType\":\"timestamp-millis\"}";
+        case AvroSchema::Type::BYTES:
+            return "\"bytes\"";
+        case AvroSchema::Type::STRING:
+            return "\"string\"";
+    }
+    return "\"bytes\"";
+}
+
+} // namespace
+
+AvroConverter::AvroConverter(std::shared_ptr<ConfigFormat> configFormat)
+        : RecordConverter(configFormat) {
+    registry = std::make_unique<AvroSchemaRegistry>(
+            configFormat->schema_registry_dir);
+}
+
+std::string AvroConverter::fieldName(const fds_tfield &tfield) const {
+    std::string name;
+    const fds_iemgr_elem *def = tfield.def;
+    if (def == nullptr || configFormat->numeric_names) {
+        name = "en" + std::to_string(tfield.en) + "_id" +
+               std::to_string(tfield.id);
+    } else {
+        name = std::string(def->scope->name) + "_" + def->name;
+    }
+
+    for (char &c : name) {
+        if (!isalnum(uint8_t(c)) && c != '_') {
+            c = '_';
+        }
+    }
+    if (isdigit(uint8_t(name[0]))) {
+        name.insert(0, 1, '_');
+    }
+    return name;
+}
+
+std::unique_ptr<AvroSchema>
+AvroConverter::compile(const fds_template *tmplt) const {
+    std::unique_ptr<AvroSchema> schema = std::make_unique<AvroSchema>();
+    schema->dynamic = (tmplt->flags & FDS_TEMPLATE_DYNAMIC) != 0;
+    schema->text = "{\"type\":\"record\",\"name\":\"Template" +
+                   std::to_string(tmplt->id) +
+                   "\",\"namespace\":\"ipfixcol2\",\"fields\":[";
+
+    std::unordered_set<std::string> names;
+    for (uint16_t i = 0; i < tmplt->fields_cnt_total; i++) {
+        const fds_tfield &tfield = tmplt->fields[i];
+        const fds_iemgr_elem *def = tfield.def;
+        if (tfield.en == 0 && tfield.id == 210) {
+            //paddingOctets
+            continue;
+        }
+        if (def == nullptr && configFormat->ignore_unknown) {
+            continue;
+        }
+        if (!isSelected(tfield)) {
+            continue;
+        }
+
+        AvroSchema::Field field;
+        field.index = i;
+        field.offset = tfield.offset;
+        field.length = tfield.length;
+        field.dataType = def ? def->data_type : FDS_ET_OCTET_ARRAY;
+        switch (field.dataType) {
+            case FDS_ET_UNSIGNED_8:
+            case FDS_ET_UNSIGNED_16:
+            case FDS_ET_UNSIGNED_32:
+            case FDS_ET_UNSIGNED_64:
+                field.type = AvroSchema::Type::UINT;
+                break;
+            case FDS_ET_SIGNED_8:
+            case FDS_ET_SIGNED_16:
+            case FDS_ET_SIGNED_32:
+            case FDS_ET_SIGNED_64:
+                field.type = AvroSchema::Type::INT;
+                break;
+            case FDS_ET_FLOAT_32:
+                field.type = AvroSchema::Type::FLOAT;
+                break;
+            case FDS_ET_FLOAT_64:
+                field.type = AvroSchema::Type::DOUBLE;
+                break;
+            case FDS_ET_BOOLEAN:
+                field.type = AvroSchema::Type::BOOLEAN;
+                break;
+            case FDS_ET_DATE_TIME_SECONDS:
+            case FDS_ET_DATE_TIME_MILLISECONDS:
+            case FDS_ET_DATE_TIME_MICROSECONDS:
+            case FDS_ET_DATE_TIME_NANOSECONDS:
+                field.type = AvroSchema::Type::TIMESTAMP;
+                break;
+            case FDS_ET_STRING:
+                field.type = AvroSchema::Type::STRING;
+                break;
+            case FDS_ET_OCTET_ARRAY:
+            case FDS_ET_MAC_ADDRESS:
+            case FDS_ET_IPV4_ADDRESS:
+            case FDS_ET_IPV6_ADDRESS:
+                field.type = AvroSchema::Type::BYTES;
+                break;
+            default:
+                //lists and unassigned types are not encoded
+                continue;
+        }
+
+        //repeated Information Elements get suffix
+        std::string name = fieldName(tfield);
+        for (uint32_t n = 2; !names.insert(name).second; n++) {
+            name = fieldName(tfield) + "_" + std::to_string(n);
+        }
+
+        if (!schema->fields.empty()) {
+            schema->text += ',';
+        }
+        schema->text += "{\"name\":\"" + name + "\",\"type\":" +
+                        typeName(field) + "}";
+        schema->fields.push_back(field);
+    }
+    schema->text += "]}";
+
+    schema->id = registry->registerSchema(schema->text);
+    if (schema->id < 0) {
+        Logger::logError("Avro schema of template " +
+                         std::to_string(tmplt->id) +
+                         " is not registered, its records are dropped");
+    }
+    return schema;
+}
+
+int AvroConverter::convert(const SharedTemplate *shared, fds_drec *rec,
+                           const fds_iemgr_t *iemgr, OutputBuffer *buffer,
+                           ConverterState *state) const {
+    (void) iemgr;
+    std::call_once(shared->planFlag, [this, shared]() {
+        shared->plan = compile(shared->tmplt);
+    });
+    const AvroSchema *schema =
+            static_cast<const AvroSchema *>(shared->plan.get());
+    if (schema->id < 0) {
+        return FDS_ERR_NOTFOUND;
+    }
+    if (schema->dynamic) {
+        collectFields(rec, state);
+    }
+
+    //encoded record is never longer than its data and headers of fields
+    const size_t bound = PREFIX_LENGTH + rec->size +
+                         MAX_VARINT_LENGTH * schema->fields.size();
+    if (!buffer->reserve(bound)) {
+        return FDS_ERR_NOMEM;
+    }
+    uint8_t *begin = reinterpret_cast<uint8_t *>(buffer->data +
+                                                 buffer->length);
+    uint8_t *out = begin;
+    *out++ = 0;
+    for (uint32_t i = 0; i < 4; i++) {
+        *out++ = uint8_t(uint32_t(schema->id) >> (24 - 8 * i));
+    }
+
+    for (const AvroSchema::Field &field : schema->fields) {
+        const uint8_t *data;
+        uint16_t size;
+        if (schema->dynamic) {
+            data = state->fields[field.index].data;
+            size = state->fields[field.index].size;
+        } else {
+            data = rec->data + field.offset;
+            size = field.length;
+        }
+        out = encodeValue(field, data, size, out);
+        if (out == nullptr) {
+            return FDS_ERR_FORMAT;
+        }
+    }
+
+    buffer->length += out - begin;
+    return out - begin;
+}
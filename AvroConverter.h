@@ -0,0 +1,94 @@
+#ifndef AVRO_CONVERTER_H
+#define AVRO_CONVERTER_H
+
+#include <ipfixcol2.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "AvroSchemaRegistry.h"
+#include "RecordConverter.h"
+
+/**
+ * \brief Avro schema of one template
+ *
+ * Generated on the first record of the template and registered in the
+ * schema registry. Holds the encoder of every field.
+ */
+class AvroSchema final : public TemplatePlan {
+public:
+    /** Avro encoding of field value */
+    enum class Type : uint8_t {
+        UINT,      /**< unsigned integer as long                           */
+        INT,       /**< signed integer as int / long                       */
+        FLOAT,     /**< float                                              */
+        DOUBLE,    /**< double                                             */
+        BOOLEAN,   /**< boolean                                            */
+        TIMESTAMP, /**< timestamp-millis (long)                            */
+        BYTES,     /**< raw field data (addresses, octet arrays)           */
+        STRING     /**< raw string                                         */
+    };
+
+    /** Encoded field */
+    struct Field {
+        /** index of the field in template                                 */
+        uint16_t index;
+        /** offset of the field in record (static templates only)          */
+        uint16_t offset;
+        /** length of the field (static templates only)                    */
+        uint16_t length;
+        /** encoding                                                       */
+        Type type;
+        /** data type of the field                                         */
+        fds_iemgr_element_type dataType;
+    };
+
+    /** ID of the schema in the registry, -1 if registration failed        */
+    int32_t id;
+    /** template has variable-length fields                                */
+    bool dynamic;
+    /** schema (JSON)                                                      */
+    std::string text;
+    /** encoded fields in template order                                   */
+    std::vector<Field> fields;
+};
+
+/**
+ * \brief Converter of IPFIX records to Avro binary encoding
+ *
+ * Every record is one message in the Confluent wire format: magic byte 0,
+ * schema ID (4 bytes, network byte order) and the Avro binary datum. Fields
+ * with lists (basicList, subTemplateList, ...) are not encoded.
+ */
+class AvroConverter final : public RecordConverter {
+private:
+    std::unique_ptr<AvroSchemaRegistry> registry;
+
+    /**
+     * Generate and register schema of the template
+     * @param[in] tmplt template
+     * @return schema
+     */
+    std::unique_ptr<AvroSchema> compile(const fds_template *tmplt) const;
+
+    /**
+     * Name of the field in schema
+     * @param[in] tfield field of template
+     * @return Avro name (letters, digits and underscores)
+     */
+    std::string fieldName(const fds_tfield &tfield) const;
+
+public:
+    /**
+     * \brief Constructor
+     *
+     * @param[in] configFormat configuration of the output format
+     */
+    explicit AvroConverter(std::shared_ptr<ConfigFormat> configFormat);
+
+    int convert(const SharedTemplate *shared, fds_drec *rec,
+                const fds_iemgr_t *iemgr, OutputBuffer *buffer,
+                ConverterState *state) const override;
+};
+
+#endif // AVRO_CONVERTER_H
@@ -0,0 +1,84 @@
+#include "AvroSchemaRegistry.h"
+#include "Logger.h"
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+//maximal number of probed IDs on collisions
+constexpr uint32_t MAX_PROBES = 64;
+
+//FNV-1a hash
+uint32_t hash(const std::string &text) {
+    uint32_t value = 2166136261U;
+    for (const char c : text) {
+        value ^= uint8_t(c);
+        value *= 16777619U;
+    }
+    return value;
+}
+
+} // namespace
+
+AvroSchemaRegistry::AvroSchemaRegistry(const std::string &directory) {
+    this->directory = directory;
+}
+
+int32_t AvroSchemaRegistry::registerSchema(const std::string &schema) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto registered = ids.find(schema);
+    if (registered != ids.end()) {
+        return registered->second;
+    }
+
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        Logger::logError("Failed to create schema registry directory " +
+                         directory);
+        return -1;
+    }
+
+    //non-negative IDs (Confluent IDs are signed)
+    uint32_t id = hash(schema) & 0x7FFFFFFF;
+    for (uint32_t i = 0; i < MAX_PROBES; i++, id = (id + 1) & 0x7FFFFFFF) {
+        const std::string path = directory + "/" + std::to_string(id) +
+                                 ".avsc";
+        std::ifstream file(path);
+        if (file) {
+            std::stringstream content;
+            content << file.rdbuf();
+            if (content.str() != schema) {
+                //collision
+                continue;
+            }
+        } else if (!write(path, schema)) {
+            Logger::logError("Failed to write schema " + path);
+            return -1;
+        }
+
+        ids.emplace(schema, int32_t(id));
+        return id;
+    }
+    Logger::logError("No free ID of schema in registry " + directory);
+    return -1;
+}
+
+bool AvroSchemaRegistry::write(const std::string &path,
+                               const std::string &schema) const {
+    const std::string tmp = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream file(tmp, std::ios::trunc);
+        file << schema;
+        if (!file.flush()) {
+            return false;
+        }
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef AVRO_SCHEMA_REGISTRY_H
+#define AVRO_SCHEMA_REGISTRY_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * \brief File-based registry of Avro schemas
+ *
+ * Every schema is stored as "<id>.avsc" in the registry directory. The ID
+ * is derived from the hash of the schema, so the same schema gets the same
+ * ID after restart and in other plugin instances sharing the directory. On
+ * collision with a different schema, the next free ID is used.
+ */
+class AvroSchemaRegistry final {
+private:
+    std::string directory;
+    std::mutex mtx;
+    //registered schemas
+    std::unordered_map<std::string, int32_t> ids;
+
+    /**
+     * Write schema file atomically (temporary file and rename)
+     * @return false on failure
+     */
+    bool write(const std::string &path, const std::string &schema) const;
+
+public:
+    /**
+     * \brief Constructor
+     * @param[in] directory directory of schema files (created if missing)
+     */
+    explicit AvroSchemaRegistry(const std::string &directory);
+
+    /**
+     * \brief Register schema
+     *
+     * @param[in] schema schema (JSON)
+     * @return schema ID or -1 on failure
+     */
+    int32_t registerSchema(const std::string &schema);
+};
+
+#endif // AVRO_SCHEMA_REGISTRY_H
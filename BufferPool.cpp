@@ -0,0 +1,158 @@
+#include "BufferPool.h"
+#include <cstdlib>
+#include <new>
+
+bool OutputBuffer::reserve(size_t additional) {
+    if (length + additional <= size) {
+        return true;
+    }
+
+    size_t newSize = size * 2;
+    while (newSize < length + additional) {
+        newSize *= 2;
+    }
+    char *newData = (char *) realloc(data, newSize);
+    if (newData == nullptr) {
+        return false;
+    }
+    data = newData;
+    size = newSize;
+    return true;
+}
+
+BufferPool::BufferPool(size_t capacity, size_t bufferSize, uint32_t shrinkMs)
+        : buffers(capacity), shrinkAfter(shrinkMs) {
+    this->bufferSize = bufferSize;
+    allocatedBytes = 0;
+    allocatedBuffers = 0;
+    largestBuffer = bufferSize;
+    grownBuffers = 0;
+    shrunkBuffers = 0;
+}
+
+BufferPool::~BufferPool() {
+    OutputBuffer *buffer;
+    while (buffers.tryPop(buffer)) {
+        free(buffer->data);
+        delete buffer;
+    }
+}
+
+OutputBuffer *BufferPool::acquire() {
+    OutputBuffer *buffer;
+    if (buffers.tryPop(buffer)) {
+        //buffer may have waited in the pool longer than the idle period
+        shrinkIdle(buffer, std::chrono::steady_clock::now());
+        buffer->length = 0;
+        buffer->compressed = false;
+        buffer->dictionaryId = 0;
+        buffer->key.clear();
+        buffer->topic = 0;
+        return buffer;
+    }
+
+    buffer = new OutputBuffer();
+    buffer->data = (char *) malloc(bufferSize);
+    if (buffer->data == nullptr) {
+        delete buffer;
+        throw std::bad_alloc();
+    }
+    buffer->size = bufferSize;
+    buffer->length = 0;
+    buffer->compressed = false;
+    buffer->dictionaryId = 0;
+    buffer->topic = 0;
+    buffer->accountedSize = bufferSize;
+    buffer->lastLargeUse = std::chrono::steady_clock::now();
+    allocatedBytes += bufferSize;
+    allocatedBuffers++;
+    return buffer;
+}
+
+void BufferPool::release(OutputBuffer *buffer) {
+    if (buffer == nullptr) {
+        return;
+    }
+    account(buffer);
+    if (buffers.tryPush(buffer)) {
+        return;
+    }
+
+    //pool is full
+    allocatedBytes -= buffer->accountedSize;
+    allocatedBuffers--;
+    free(buffer->data);
+    delete buffer;
+}
+
+void BufferPool::account(OutputBuffer *buffer) {
+    if (buffer->size != buffer->accountedSize) {
+        //grown by the converter since the last release
+        allocatedBytes += buffer->size - buffer->accountedSize;
+        buffer->accountedSize = buffer->size;
+        grownBuffers++;
+        size_t largest = largestBuffer.load(std::memory_order_relaxed);
+        while (buffer->size > largest &&
+               !largestBuffer.compare_exchange_weak(largest, buffer->size)) {
+        }
+    }
+    if (buffer->size == bufferSize) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (buffer->length > bufferSize) {
+        buffer->lastLargeUse = now;
+        return;
+    }
+    shrinkIdle(buffer, now);
+}
+
+void BufferPool::shrinkIdle(OutputBuffer *buffer,
+                            std::chrono::steady_clock::time_point now) {
+    if (buffer->size == bufferSize || shrinkAfter.count() == 0 ||
+        now - buffer->lastLargeUse < shrinkAfter) {
+        return;
+    }
+
+    //extra room was not needed for the idle period
+    char *data = (char *) realloc(buffer->data, bufferSize);
+    if (data == nullptr) {
+        return;
+    }
+    allocatedBytes -= buffer->size - bufferSize;
+    buffer->data = data;
+    buffer->size = bufferSize;
+    buffer->accountedSize = bufferSize;
+    shrunkBuffers++;
+}
+
+void BufferPool::sweep() {
+    if (shrinkAfter.count() == 0) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    //each pooled buffer is visited once, unless it is acquired and released
+    //meanwhile
+    for (size_t i = buffers.capacity(); i > 0; i--) {
+        OutputBuffer *buffer;
+        if (!buffers.tryPop(buffer)) {
+            return;
+        }
+        shrinkIdle(buffer, now);
+        if (!buffers.tryPush(buffer)) {
+            allocatedBytes -= buffer->accountedSize;
+            allocatedBuffers--;
+            free(buffer->data);
+            delete buffer;
+        }
+    }
+}
+
+std::string BufferPool::stats() const {
+    return std::to_string(allocatedBuffers.load()) + " buffers (" +
+           std::to_string(allocatedBytes.load()) + " bytes), largest " +
+           std::to_string(largestBuffer.load()) + " bytes, grown " +
+           std::to_string(grownBuffers.load()) + " times, shrunk " +
+           std::to_string(shrunkBuffers.load()) + " times";
+}
@@ -0,0 +1,133 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include "MpmcQueue.h"
+
+/**
+ * \brief Heap buffer for converted messages
+ *
+ * Data are allocated by malloc, so the converter may grow them by realloc.
+ */
+struct OutputBuffer {
+    /** buffer data                                                         */
+    char *data;
+    /** allocated size of data                                              */
+    size_t size;
+    /** used bytes of data                                                  */
+    size_t length;
+    /** size of data accounted in statistics of the pool                    */
+    size_t accountedSize;
+    /** last time the buffer held more than the initial size                */
+    std::chrono::steady_clock::time_point lastLargeUse;
+    /** data are compressed by zstd                                         */
+    bool compressed;
+    /** ID of zstd dictionary of compressed data (0 - no dictionary)        */
+    uint32_t dictionaryId;
+    /** key of kafka message (empty - no key)                               */
+    std::string key;
+    /** index of topic of kafka message (0 - default topic)                 */
+    uint16_t topic;
+
+    /**
+     * \brief Make room for additional bytes after used bytes
+     * @param[in] additional number of bytes
+     * @return false on allocation failure
+     */
+    bool reserve(size_t additional);
+};
+
+/**
+ * \brief Pool of output buffers
+ *
+ * Buffers travel from conversion threads to the kafka producer and back via
+ * delivery reports. Acquire and release are lock-free, buffers keep their
+ * grown size (high-water mark) in the pool, so large records do not hit the
+ * allocator again. A grown buffer is shrunk to the initial size when it has
+ * not needed the extra room for the idle period. Buffers released to a full
+ * pool are freed.
+ */
+class BufferPool final {
+private:
+    MpmcQueue<OutputBuffer *> buffers;
+    //initial size of new buffers
+    size_t bufferSize;
+    //idle period of grown buffers before shrinking (0 - never)
+    std::chrono::milliseconds shrinkAfter;
+
+    //statistics
+    std::atomic_size_t allocatedBytes;
+    std::atomic_size_t allocatedBuffers;
+    std::atomic_size_t largestBuffer;
+    std::atomic_size_t grownBuffers;
+    std::atomic_size_t shrunkBuffers;
+
+    /**
+     * Update statistics by the current size of the buffer and shrink it if
+     * it is idle
+     * @param[in] buffer released buffer
+     */
+    void account(OutputBuffer *buffer);
+
+    /**
+     * Shrink grown buffer to the initial size if it has not needed the extra
+     * room for the idle period
+     * @param[in] buffer pooled or released buffer
+     * @param[in] now current time
+     */
+    void shrinkIdle(OutputBuffer *buffer,
+                    std::chrono::steady_clock::time_point now);
+
+public:
+    /**
+     * \brief Constructor
+     * @param[in] capacity maximal number of pooled buffers
+     * @param[in] bufferSize initial size of new buffers
+     * @param[in] shrinkMs idle period [ms] of grown buffers before shrinking
+     * (0 - never)
+     */
+    BufferPool(size_t capacity, size_t bufferSize, uint32_t shrinkMs);
+
+    BufferPool(const BufferPool &) = delete;
+
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    /**
+     * \brief Destructor
+     * Free pooled buffers
+     */
+    ~BufferPool();
+
+    /**
+     * \brief Take empty buffer from pool (or allocate new one)
+     * @return buffer
+     * @throw bad_alloc
+     */
+    OutputBuffer *acquire();
+
+    /**
+     * \brief Return buffer to pool
+     * @param[in] buffer buffer (may be nullptr)
+     */
+    void release(OutputBuffer *buffer);
+
+    /**
+     * \brief Shrink idle buffers waiting in the pool
+     *
+     * Buffers are also checked when they are acquired and released, the
+     * sweep returns memory of buffers which are not used at all (e.g. after
+     * a burst of large records). Thread-safe.
+     */
+    void sweep();
+
+    /**
+     * \brief Statistics of buffers (allocated bytes, largest buffer, ...)
+     */
+    std::string stats() const;
+};
+
+#endif // BUFFER_POOL_H
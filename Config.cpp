@@ -1,9 +1,51 @@
+#include <arpa/inet.h>
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
 #include <limits.h>
 #include "Config.h"
 
 #include <memory>
 
+namespace {
+
+//names separated by commas or white spaces
+std::vector<std::string> splitNames(const char *value) {
+    std::string list = value;
+    for (char &c : list) {
+        if (c == ',') {
+            c = ' ';
+        }
+    }
+    std::istringstream names(list);
+    std::vector<std::string> result;
+    std::string name;
+    while (names >> name) {
+        result.push_back(name);
+    }
+    return result;
+}
+
+//unsigned numbers separated by commas or white spaces
+std::vector<uint64_t> parseNumbers(const std::string &attr, const char *value,
+                                   uint64_t max) {
+    std::vector<uint64_t> result;
+    for (const std::string &name : splitNames(value)) {
+        char *end;
+        errno = 0;
+        const unsigned long long number = strtoull(name.c_str(), &end, 0);
+        if (errno != 0 || *end != '\0' || name[0] == '-' || number > max) {
+            throw std::invalid_argument(
+                    "Invalid value '" + name + "' of the attribute <route " +
+                    attr + ">!");
+        }
+        result.push_back(number);
+    }
+    return result;
+}
+
+} // namespace
+
 Config::Config(const char *params) {
     configFormat = std::make_shared<ConfigFormat>(ConfigFormat());
     configKafka = std::make_shared<ConfigKafka>(ConfigKafka());
@@ -28,6 +70,70 @@ Config::Config(const char *params) {
                 "Failed to parse the configuration: " + err);
     }
     parseParams(params_ctx);
+
+#ifndef HAVE_ZSTD
+    if (configProcessing->compression) {
+        throw std::invalid_argument(
+                "Compression of messages (<compression>) is not available, "
+                "the plugin is built without zstd!");
+    }
+#endif
+
+    if (configFormat->compact && configFormat->output != OUTPUT_JSON) {
+        throw std::invalid_argument(
+                "Compact records (<compact>) are supported only with JSON "
+                "output!");
+    }
+    //templates are published by compiled plans, records converted by
+    //fds_drec2json would be full objects
+    if (configFormat->compact && !configProcessing->compiledConversion) {
+        throw std::invalid_argument(
+                "Compact records (<compact>) require compiled conversion "
+                "(<compiledConversion>)!");
+    }
+
+    //Arrow batches records of one template by itself
+    if (configFormat->output != OUTPUT_JSON &&
+        configFormat->output != OUTPUT_ARROW &&
+        configProcessing->batchMaxRecords > 1) {
+        throw std::invalid_argument(
+                "Batching of records (<batchMaxRecords>) is supported only "
+                "with JSON and Arrow output!");
+    }
+
+    if (configKafka->messageKey == KEY_FIELDS &&
+        configKafka->keyFields.empty()) {
+        throw std::invalid_argument(
+                "Message key 'fields' requires list of fields "
+                "(<keyFields>)!");
+    }
+    //one key per message, batches mix records of many flows
+    if ((configKafka->messageKey == KEY_FLOW ||
+         configKafka->messageKey == KEY_FIELDS) &&
+        (configProcessing->batchMaxRecords > 1 ||
+         configFormat->output == OUTPUT_ARROW)) {
+        throw std::invalid_argument(
+                "Message key 'flow' or 'fields' (<messageKey>) is not "
+                "supported with batching of records!");
+    }
+    //batches of Arrow have one template, records of the template may
+    //differ in values
+    if (configFormat->output == OUTPUT_ARROW) {
+        for (const ConfigRoute &route : configKafka->routes) {
+            if (!route.field.empty()) {
+                throw std::invalid_argument(
+                        "Routes by value of field (<route field>) are not "
+                        "supported with Arrow output!");
+            }
+        }
+    }
+    //pending Arrow batches are drained apart from their records
+    if (configKafka->messageKey == KEY_ODID &&
+        configFormat->output == OUTPUT_ARROW) {
+        throw std::invalid_argument(
+                "Message key 'odid' (<messageKey>) is not supported with "
+                "Arrow output!");
+    }
 }
 
 Config::~Config() {
@@ -43,16 +149,37 @@ void Config::setDefaultConfig() {
     configFormat->octets_as_uint = true;
     configFormat->numeric_names = false;
     configFormat->split_biflow = false;
+    configFormat->projection = FIELDS_ALL;
+    configFormat->output = OUTPUT_JSON;
+    configFormat->schema_registry_dir = getenv("HOME") +
+                                        std::string("/ipfixcol2schemas");
+    configFormat->compact = false;
 
     configKafka->hostName = "127.0.0.1";
     configKafka->port = "9092";
     configKafka->topicList = "netflow";
+    configKafka->templateTopic = "templates";
+    configKafka->messageKey = KEY_NONE;
 
     configProcessing->processMessageLength = 1024;
     configProcessing->messagesBufferSize = 1024;
     configProcessing->loggerConfigFile = getenv("HOME") +
                                     std::string(
                                             "/ipfixcol2jsontokafka.conf");
+    configProcessing->zeroCopy = true;
+    configProcessing->workStealing = false;
+    configProcessing->dispatchByOdid = false;
+    configProcessing->bufferPoolSize = 4096;
+    configProcessing->bufferShrinkMs = 60000;
+    configProcessing->batchMaxRecords = 1;
+    configProcessing->batchMaxBytes = 524288;
+    configProcessing->batchLingerMs = 100;
+    configProcessing->compiledConversion = true;
+    configProcessing->verifyConversion = 16;
+    configProcessing->compression = false;
+    configProcessing->zstdLevel = 3;
+    configProcessing->zstdDictionary = "";
+    configProcessing->zstdTrainSamples = 1000;
 }
 
 void Config::parseParams(fds_xml_ctx_t *params) {
@@ -101,6 +228,36 @@ void Config::parseParams(fds_xml_ctx_t *params) {
                 //assert(content->type == FDS_OPTS_T_BOOL);
                 configFormat->split_biflow = content->val_bool;
                 break;
+            case FMT_FIELDS:
+                parseFields(content->ptr_ctx);
+                break;
+            case FMT_OUTPUT: // Output format
+                //assert(content->type == FDS_OPTS_T_STRING);
+                if (strcasecmp(content->ptr_string, "json") == 0) {
+                    configFormat->output = OUTPUT_JSON;
+                } else if (strcasecmp(content->ptr_string, "avro") == 0) {
+                    configFormat->output = OUTPUT_AVRO;
+                } else if (strcasecmp(content->ptr_string, "msgpack") == 0) {
+                    configFormat->output = OUTPUT_MSGPACK;
+                } else if (strcasecmp(content->ptr_string, "cbor") == 0) {
+                    configFormat->output = OUTPUT_CBOR;
+                } else if (strcasecmp(content->ptr_string, "arrow") == 0) {
+                    configFormat->output = OUTPUT_ARROW;
+                } else {
+                    throw std::invalid_argument(
+                            "Unexpected parameter of the element "
+                            "<outputFormat> (expected 'json', 'avro', "
+                            "'msgpack', 'cbor' or 'arrow')!");
+                }
+                break;
+            case FMT_SCHEMA_DIR:
+                //assert(content->type == FDS_OPTS_T_STRING);
+                configFormat->schema_registry_dir = content->ptr_string;
+                break;
+            case FMT_COMPACT:
+                //assert(content->type == FDS_OPTS_T_BOOL);
+                configFormat->compact = content->val_bool;
+                break;
             case KAFKA:
                 parseKafka(content->ptr_ctx);
                 break;
@@ -130,6 +287,37 @@ void Config::parseKafka(fds_xml_ctx_t *kafka) {
                 //assert(content->type == FDS_OPTS_T_STRING);
                 configKafka->topicList = content->ptr_string;
                 break;
+            case KAFKA_TEMPLATE_TOPIC:
+                //assert(content->type == FDS_OPTS_T_STRING);
+                configKafka->templateTopic = content->ptr_string;
+                break;
+            case KAFKA_MESSAGE_KEY:
+                //assert(content->type == FDS_OPTS_T_STRING);
+                if (strcasecmp(content->ptr_string, "none") == 0) {
+                    configKafka->messageKey = KEY_NONE;
+                } else if (strcasecmp(content->ptr_string, "odid") == 0) {
+                    configKafka->messageKey = KEY_ODID;
+                } else if (strcasecmp(content->ptr_string, "flow") == 0) {
+                    configKafka->messageKey = KEY_FLOW;
+                } else if (strcasecmp(content->ptr_string, "fields") == 0) {
+                    configKafka->messageKey = KEY_FIELDS;
+                } else {
+                    throw std::invalid_argument(
+                            "Unexpected parameter of the element "
+                            "<messageKey> (expected 'none', 'odid', 'flow' "
+                            "or 'fields')!");
+                }
+                break;
+            case KAFKA_KEY_FIELDS:
+                //assert(content->type == FDS_OPTS_T_STRING);
+                configKafka->keyFields = splitNames(content->ptr_string);
+                break;
+            case KAFKA_ROUTE:
+                parseRoute(content->ptr_ctx);
+                break;
+            case KAFKA_PROPERTY:
+                parseProperty(content->ptr_ctx);
+                break;
             default:
                 throw std::invalid_argument(
                         "Unexpected element within <kafka>!");
@@ -137,29 +325,254 @@ void Config::parseKafka(fds_xml_ctx_t *kafka) {
     }
 }
 
+void Config::parseFields(fds_xml_ctx_t *fields) {
+    const fds_xml_cont *content;
+    while (fds_xml_next(fields, &content) != FDS_EOC) {
+        fields_projection projection;
+        switch (content->id) {
+            case FIELDS_INCLUDE:
+                projection = FIELDS_ONLY;
+                break;
+            case FIELDS_EXCLUDE:
+                projection = FIELDS_EXCEPT;
+                break;
+            default:
+                throw std::invalid_argument(
+                        "Unexpected element within <fields>!");
+        }
+        if (configFormat->projection != FIELDS_ALL) {
+            throw std::invalid_argument(
+                    "Only one of include / exclude lists within <fields> "
+                    "is allowed!");
+        }
+        configFormat->projection = projection;
+
+        for (const std::string &name : splitNames(content->ptr_string)) {
+            configFormat->fields.insert(name);
+        }
+        if (configFormat->fields.empty()) {
+            throw std::invalid_argument("Empty list of fields within "
+                                        "<fields>!");
+        }
+    }
+}
+
+void Config::parseRoute(fds_xml_ctx_t *route) {
+    ConfigRoute config;
+    config.records = RECORDS_ALL;
+    const fds_xml_cont *content;
+    while (fds_xml_next(route, &content) != FDS_EOC) {
+        switch (content->id) {
+            case ROUTE_TOPIC:
+                config.topic = content->ptr_string;
+                break;
+            case ROUTE_EXPORTER:
+                for (const std::string &name :
+                        splitNames(content->ptr_string)) {
+                    //IPv4 addresses are mapped to IPv6
+                    in6_addr address;
+                    in_addr ipv4;
+                    if (inet_pton(AF_INET, name.c_str(), &ipv4) == 1) {
+                        memset(&address, 0, sizeof(address));
+                        address.s6_addr[10] = 0xff;
+                        address.s6_addr[11] = 0xff;
+                        memcpy(&address.s6_addr[12], &ipv4, sizeof(ipv4));
+                    } else if (inet_pton(AF_INET6, name.c_str(),
+                                         &address) != 1) {
+                        throw std::invalid_argument(
+                                "Invalid address '" + name + "' of the "
+                                "attribute <route exporter>!");
+                    }
+                    config.exporters.push_back(address);
+                }
+                break;
+            case ROUTE_ODID:
+                for (uint64_t odid : parseNumbers("odid", content->ptr_string,
+                                                  UINT32_MAX)) {
+                    config.odids.push_back(odid);
+                }
+                break;
+            case ROUTE_TEMPLATE:
+                for (uint64_t id : parseNumbers("template",
+                                                content->ptr_string,
+                                                UINT16_MAX)) {
+                    config.templates.push_back(id);
+                }
+                break;
+            case ROUTE_RECORD:
+                config.records = check_or("record", content->ptr_string,
+                                          "options", "data") ?
+                                 RECORDS_OPTIONS : RECORDS_DATA;
+                break;
+            case ROUTE_FIELD:
+                config.field = content->ptr_string;
+                break;
+            case ROUTE_VALUE:
+                config.values = parseNumbers("value", content->ptr_string,
+                                             UINT64_MAX);
+                break;
+            default:
+                throw std::invalid_argument(
+                        "Unexpected element within <route>!");
+        }
+    }
+
+    if (config.topic.empty()) {
+        throw std::invalid_argument("Empty topic of <route>!");
+    }
+    if (config.field.empty() != config.values.empty()) {
+        throw std::invalid_argument(
+                "Attributes field and value of <route> must be used "
+                "together!");
+    }
+    configKafka->routes.push_back(config);
+}
+
+void Config::parseProperty(fds_xml_ctx_t *property) {
+    std::string name;
+    std::string value;
+    const fds_xml_cont *content;
+    while (fds_xml_next(property, &content) != FDS_EOC) {
+        switch (content->id) {
+            case PROPERTY_NAME:
+                name = content->ptr_string;
+                break;
+            case PROPERTY_VALUE:
+                value = content->ptr_string;
+                break;
+            default:
+                throw std::invalid_argument(
+                        "Unexpected element within <property>!");
+        }
+    }
+
+    if (name.empty()) {
+        throw std::invalid_argument("Empty name of <property>!");
+    }
+    //sent buffers return to the pool from delivery reports
+    if (name == "delivery.report.only.error") {
+        throw std::invalid_argument(
+                "Property delivery.report.only.error of <property> is not "
+                "supported!");
+    }
+    //values are checked by librdkafka on connect
+    configKafka->properties.emplace_back(name, value);
+}
+
 void Config::parseProcessing(fds_xml_ctx_t *processing) {
     const fds_xml_cont *content;
+    bool trainSamplesSet = false;
     while (fds_xml_next(processing, &content) != FDS_EOC) {
         switch (content->id) {
             case PROCESSING_PROCESS_MESSAGE_LENGTH:
-                configProcessing->processMessageLength = content->val_int;
-                if(configProcessing->processMessageLength < 256){
+                if(content->val_int < 256){
                     configProcessing->processMessageLength = 256;
+                } else {
+                    configProcessing->processMessageLength = content->val_int;
                 }
                 break;
             case PROCESSING_MESSAGES_BUFFER_SIZE:
-                configProcessing->messagesBufferSize = content->val_int;
-                if(configProcessing->messagesBufferSize < 256){
+                if(content->val_int < 256){
                     configProcessing->messagesBufferSize = 256;
+                } else {
+                    configProcessing->messagesBufferSize = content->val_int;
+                }
+                break;
+            case PROCESSING_BUFFER_POOL_SIZE:
+                if(content->val_int < 256){
+                    configProcessing->bufferPoolSize = 256;
+                } else {
+                    configProcessing->bufferPoolSize = content->val_int;
+                }
+                break;
+            case PROCESSING_BUFFER_SHRINK_MS:
+                if(content->val_int < 0){
+                    configProcessing->bufferShrinkMs = 0;
+                } else {
+                    configProcessing->bufferShrinkMs = content->val_int;
+                }
+                break;
+            case PROCESSING_BATCH_MAX_RECORDS:
+                //checked before assignment, negative values would wrap
+                if(content->val_int < 1){
+                    configProcessing->batchMaxRecords = 1;
+                } else {
+                    configProcessing->batchMaxRecords = content->val_int;
+                }
+                break;
+            case PROCESSING_BATCH_MAX_BYTES:
+                if(content->val_int < 1024){
+                    configProcessing->batchMaxBytes = 1024;
+                } else {
+                    configProcessing->batchMaxBytes = content->val_int;
+                }
+                break;
+            case PROCESSING_BATCH_LINGER_MS:
+                if(content->val_int < 0){
+                    configProcessing->batchLingerMs = 0;
+                } else {
+                    configProcessing->batchLingerMs = content->val_int;
                 }
                 break;
+            case PROCESSING_COMPILED_CONVERSION:
+                configProcessing->compiledConversion = content->val_bool;
+                break;
+            case PROCESSING_VERIFY_CONVERSION:
+                if(content->val_int < 0){
+                    configProcessing->verifyConversion = 0;
+                } else {
+                    configProcessing->verifyConversion = content->val_int;
+                }
+                break;
+            case PROCESSING_COMPRESSION:
+                configProcessing->compression = check_or(
+                        "compression", content->ptr_string, "zstd", "none");
+                break;
+            case PROCESSING_ZSTD_LEVEL:
+                configProcessing->zstdLevel = content->val_int;
+                break;
+            case PROCESSING_ZSTD_DICTIONARY:
+                configProcessing->zstdDictionary = content->ptr_string;
+                break;
+            case PROCESSING_ZSTD_TRAIN_SAMPLES:
+                if(content->val_int < 0){
+                    configProcessing->zstdTrainSamples = 0;
+                } else {
+                    configProcessing->zstdTrainSamples = content->val_int;
+                }
+                trainSamplesSet = true;
+                break;
             case PROCESSING_LOGGER_CONFIG_FILE:
                 configProcessing->loggerConfigFile = content->ptr_string;
                 break;
+            case PROCESSING_ZERO_COPY:
+                configProcessing->zeroCopy = content->val_bool;
+                break;
+            case PROCESSING_SCHEDULER:
+                configProcessing->workStealing = check_or(
+                        "scheduler", content->ptr_string, "stealing",
+                        "shared");
+                break;
+            case PROCESSING_DISPATCH:
+                configProcessing->dispatchByOdid = check_or(
+                        "dispatch", content->ptr_string, "odid",
+                        "roundRobin");
+                break;
             default:
                 throw std::invalid_argument(
-                        "Unexpected element within <parser>!");
+                        "Unexpected element within <processing>!");
+        }
+    }
+
+    //trained dictionary is distributed to consumers only by the file,
+    //without it the messages could not be decompressed
+    if (configProcessing->zstdDictionary.empty()) {
+        if (trainSamplesSet && configProcessing->zstdTrainSamples > 0) {
+            throw std::invalid_argument(
+                    "Training of zstd dictionary (<zstdTrainSamples>) "
+                    "requires file of the dictionary (<zstdDictionary>)!");
         }
+        configProcessing->zstdTrainSamples = 0;
     }
 }
 
@@ -2,11 +2,15 @@
 #define CONFIG_H
 
 #include <ipfixcol2.h>
+#include <netinet/in.h>
 #include <cstdint>
 #include <memory>
 
 #include <string>
 #include <sstream>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 /** XML nodes in configuration file*/
 enum params_xml_nodes {
@@ -20,16 +24,77 @@ enum params_xml_nodes {
     FMT_OCTETASUINT, /**< OctetArray as unsigned integer                     */
     FMT_NUMERIC,     /**< Use numeric names                                  */
     FMT_BFSPLIT,     /**< Split biflow                                       */
+    FMT_FIELDS,      /**< Projection of fields                               */
+    FMT_OUTPUT,      /**< Output format of records                           */
+    FMT_SCHEMA_DIR,  /**< Directory of schema registry                       */
+    FMT_COMPACT,     /**< Positional records referencing templates           */
+    FIELDS_INCLUDE,  /**< Emitted fields                                     */
+    FIELDS_EXCLUDE,  /**< Dropped fields                                     */
     KAFKA,              /**< Apache Kafka config node                        */
     KAFKA_HOST_NAME,    /**< Apache Kafka host name                          */
     KAFKA_PORT,         /**< Apache Kafka port                               */
     KAFKA_TOPIC_LIST,   /**< Apache kafka topic list                         */
+    KAFKA_TEMPLATE_TOPIC, /**< Topic of templates (compact records)          */
+    KAFKA_MESSAGE_KEY,  /**< Key of messages                                 */
+    KAFKA_KEY_FIELDS,   /**< Fields of message key                           */
+    KAFKA_ROUTE,        /**< Route of records to topic                       */
+    ROUTE_TOPIC,        /**< Topic of route                                  */
+    ROUTE_EXPORTER,     /**< Exporter addresses                              */
+    ROUTE_ODID,         /**< Observation domain IDs                          */
+    ROUTE_TEMPLATE,     /**< Template IDs                                    */
+    ROUTE_RECORD,       /**< Data or options records                         */
+    ROUTE_FIELD,        /**< Compared field                                  */
+    ROUTE_VALUE,        /**< Values of compared field                        */
+    KAFKA_PROPERTY,     /**< Property of librdkafka                          */
+    PROPERTY_NAME,      /**< Name of property                                */
+    PROPERTY_VALUE,     /**< Value of property                               */
     PROCESSING,                         /**< Procesing node                  */
     PROCESSING_PROCESS_MESSAGE_LENGTH,  /**< message buffer size             */
     PROCESSING_MESSAGES_BUFFER_SIZE,    /**< input / output buffer size      */
     PROCESSING_LOGGER_CONFIG_FILE,            /**< path for log config file  */
+    PROCESSING_ZERO_COPY,               /**< borrow messages from pipeline   */
+    PROCESSING_SCHEDULER,               /**< shared / work stealing buffers  */
+    PROCESSING_DISPATCH,                /**< distribution among threads      */
+    PROCESSING_BUFFER_POOL_SIZE,        /**< pooled output buffers           */
+    PROCESSING_BUFFER_SHRINK_MS,        /**< idle period of grown buffers    */
+    PROCESSING_BATCH_MAX_RECORDS,       /**< records in one kafka message    */
+    PROCESSING_BATCH_MAX_BYTES,         /**< bytes of one kafka message      */
+    PROCESSING_BATCH_LINGER_MS,         /**< max delay of batched records    */
+    PROCESSING_COMPILED_CONVERSION,     /**< per-template JSON conversion    */
+    PROCESSING_VERIFY_CONVERSION,       /**< cross-checked records           */
+    PROCESSING_COMPRESSION,             /**< compression of messages         */
+    PROCESSING_ZSTD_LEVEL,              /**< zstd compression level          */
+    PROCESSING_ZSTD_DICTIONARY,         /**< file of zstd dictionary         */
+    PROCESSING_ZSTD_TRAIN_SAMPLES,      /**< messages for dictionary training*/
 
 };
+/** Output format of records */
+enum output_format {
+    OUTPUT_JSON,     /**< JSON text                                          */
+    OUTPUT_AVRO,     /**< Avro binary (Confluent wire format)                */
+    OUTPUT_MSGPACK,  /**< MessagePack                                        */
+    OUTPUT_CBOR,     /**< CBOR                                               */
+    OUTPUT_ARROW     /**< Apache Arrow IPC streams (batches of one template) */
+};
+/** Key of kafka messages */
+enum message_key {
+    KEY_NONE,        /**< messages without key                               */
+    KEY_ODID,        /**< observation domain ID                              */
+    KEY_FLOW,        /**< symmetric hash of 5-tuple                          */
+    KEY_FIELDS       /**< values of listed fields                            */
+};
+/** Records matched by route */
+enum route_records {
+    RECORDS_ALL,     /**< all records                                        */
+    RECORDS_DATA,    /**< records of data templates                          */
+    RECORDS_OPTIONS  /**< records of options templates                       */
+};
+/** Projection of record fields */
+enum fields_projection {
+    FIELDS_ALL,      /**< all fields are emitted                             */
+    FIELDS_ONLY,     /**< only listed fields are emitted                     */
+    FIELDS_EXCEPT    /**< listed fields are dropped                          */
+};
 /**
  * \brief Configuration for JSON output format
  * All values for configuration JSON format
@@ -53,6 +118,36 @@ struct ConfigFormat {
     bool numeric_names;
     /** Split biflow records                                                   */
     bool split_biflow;
+    /** Projection of fields                                                   */
+    fields_projection projection;
+    /** Listed fields ("scope:name", "name" of IANA or "enX:idY")              */
+    std::unordered_set<std::string> fields;
+    /** Output format of records                                               */
+    output_format output;
+    /** Directory of file-based schema registry (Avro)                         */
+    std::string schema_registry_dir;
+    /** Records as arrays of values referencing published templates (JSON)    */
+    bool compact;
+};
+/**
+ * \brief Route of records to topic
+ * Conditions without values match all records
+ */
+struct ConfigRoute {
+    /** topic of matched records                                   */
+    std::string topic;
+    /** exporter addresses (IPv4 mapped to IPv6)                   */
+    std::vector<in6_addr> exporters;
+    /** observation domain IDs                                     */
+    std::vector<uint32_t> odids;
+    /** template IDs                                               */
+    std::vector<uint16_t> templates;
+    /** type of records                                            */
+    route_records records;
+    /** compared field ("scope:name", "name" or "enX:idY")         */
+    std::string field;
+    /** values of compared field (unsigned integers)               */
+    std::vector<uint64_t> values;
 };
 /**
  * \brief Configuration for kafka producent
@@ -65,6 +160,16 @@ struct ConfigKafka {
     std::string port;
     /** apache kafka topic list     */
     std::string topicList;
+    /** topic of templates of compact records (compacted, keyed)  */
+    std::string templateTopic;
+    /** key of messages (partitioning)                            */
+    message_key messageKey;
+    /** fields of key in order ("scope:name", "name" or "enX:idY") */
+    std::vector<std::string> keyFields;
+    /** routes of records, the first matching route is used       */
+    std::vector<ConfigRoute> routes;
+    /** properties of librdkafka (name, value) in configured order */
+    std::vector<std::pair<std::string, std::string>> properties;
 };
 /**
  * \brief Configuration for plugin process pipeline
@@ -77,7 +182,56 @@ struct ConfigProcessing {
     uint32_t messagesBufferSize;
     /** path for log file*/
     std::string loggerConfigFile;
+    /** borrow IPFIX messages instead of copying their records             */
+    bool zeroCopy;
+    /** input buffer per thread with work stealing - true, shared - false  */
+    bool workStealing;
+    /** distribute messages by ODID - true, round-robin - false            */
+    bool dispatchByOdid;
+    /** maximal number of pooled output buffers  minimum 256               */
+    uint32_t bufferPoolSize;
+    /** idle period [ms] of grown output buffers before shrinking (0 - never)*/
+    uint32_t bufferShrinkMs;
+    /** records batched into one kafka message (1 - no batching)           */
+    uint32_t batchMaxRecords;
+    /** size of batch when it is sent regardless of other limits           */
+    uint32_t batchMaxBytes;
+    /** maximal time [ms] of the first record in unsent batch              */
+    uint32_t batchLingerMs;
+    /** convert records by compiled per-template plans                     */
+    bool compiledConversion;
+    /** records of each template cross-checked against fds_drec2json       */
+    uint32_t verifyConversion;
+    /** compress messages by zstd in conversion threads                    */
+    bool compression;
+    /** zstd compression level                                             */
+    int zstdLevel;
+    /** file of zstd dictionary (loaded, or written after training)        */
+    std::string zstdDictionary;
+    /** messages sampled for training of dictionary (0 - no training)      */
+    uint32_t zstdTrainSamples;
 };
+/** Definition of the \<route>\*/
+static const struct fds_xml_args args_route[] = {
+        FDS_OPTS_ATTR(ROUTE_TOPIC, "topic", FDS_OPTS_T_STRING, 0),
+        FDS_OPTS_ATTR(ROUTE_EXPORTER, "exporter", FDS_OPTS_T_STRING,
+                      FDS_OPTS_P_OPT),
+        FDS_OPTS_ATTR(ROUTE_ODID, "odid", FDS_OPTS_T_STRING,
+                      FDS_OPTS_P_OPT),
+        FDS_OPTS_ATTR(ROUTE_TEMPLATE, "template", FDS_OPTS_T_STRING,
+                      FDS_OPTS_P_OPT),
+        FDS_OPTS_ATTR(ROUTE_RECORD, "record", FDS_OPTS_T_STRING,
+                      FDS_OPTS_P_OPT),
+        FDS_OPTS_ATTR(ROUTE_FIELD, "field", FDS_OPTS_T_STRING,
+                      FDS_OPTS_P_OPT),
+        FDS_OPTS_ATTR(ROUTE_VALUE, "value", FDS_OPTS_T_STRING,
+                      FDS_OPTS_P_OPT),
+        FDS_OPTS_END};
+/** Definition of the \<property>\*/
+static const struct fds_xml_args args_property[] = {
+        FDS_OPTS_ATTR(PROPERTY_NAME, "name", FDS_OPTS_T_STRING, 0),
+        FDS_OPTS_ATTR(PROPERTY_VALUE, "value", FDS_OPTS_T_STRING, 0),
+        FDS_OPTS_END};
 /** Definition of the \<kafka>\*/
 static const struct fds_xml_args args_kafka[] = {
         FDS_OPTS_ELEM(KAFKA_HOST_NAME, "hostName", FDS_OPTS_T_STRING,
@@ -86,6 +240,16 @@ static const struct fds_xml_args args_kafka[] = {
                       FDS_OPTS_P_OPT),
         FDS_OPTS_ELEM(KAFKA_TOPIC_LIST, "topicList", FDS_OPTS_T_STRING,
                       FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(KAFKA_TEMPLATE_TOPIC, "templateTopic",
+                      FDS_OPTS_T_STRING, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(KAFKA_MESSAGE_KEY, "messageKey", FDS_OPTS_T_STRING,
+                      FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(KAFKA_KEY_FIELDS, "keyFields", FDS_OPTS_T_STRING,
+                      FDS_OPTS_P_OPT),
+        FDS_OPTS_NESTED(KAFKA_ROUTE, "route", args_route,
+                        FDS_OPTS_P_OPT | FDS_OPTS_P_MULTI),
+        FDS_OPTS_NESTED(KAFKA_PROPERTY, "property", args_property,
+                        FDS_OPTS_P_OPT | FDS_OPTS_P_MULTI),
         FDS_OPTS_END};
 /** Definition of the \<processing>\*/
 static const struct fds_xml_args args_processing[] = {
@@ -96,6 +260,41 @@ static const struct fds_xml_args args_processing[] = {
                       FDS_OPTS_T_INT, FDS_OPTS_P_OPT),
         FDS_OPTS_ELEM(PROCESSING_LOGGER_CONFIG_FILE, "loggerConfigFile",
                       FDS_OPTS_T_STRING, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_ZERO_COPY, "zeroCopy",
+                      FDS_OPTS_T_BOOL, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_SCHEDULER, "scheduler",
+                      FDS_OPTS_T_STRING, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_DISPATCH, "dispatch",
+                      FDS_OPTS_T_STRING, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_BUFFER_POOL_SIZE, "bufferPoolSize",
+                      FDS_OPTS_T_INT, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_BUFFER_SHRINK_MS, "bufferShrinkMs",
+                      FDS_OPTS_T_INT, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_BATCH_MAX_RECORDS, "batchMaxRecords",
+                      FDS_OPTS_T_INT, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_BATCH_MAX_BYTES, "batchMaxBytes",
+                      FDS_OPTS_T_INT, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_BATCH_LINGER_MS, "batchLingerMs",
+                      FDS_OPTS_T_INT, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_COMPILED_CONVERSION, "compiledConversion",
+                      FDS_OPTS_T_BOOL, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_VERIFY_CONVERSION, "verifyConversion",
+                      FDS_OPTS_T_INT, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_COMPRESSION, "compression",
+                      FDS_OPTS_T_STRING, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_ZSTD_LEVEL, "zstdLevel",
+                      FDS_OPTS_T_INT, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_ZSTD_DICTIONARY, "zstdDictionary",
+                      FDS_OPTS_T_STRING, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(PROCESSING_ZSTD_TRAIN_SAMPLES, "zstdTrainSamples",
+                      FDS_OPTS_T_INT, FDS_OPTS_P_OPT),
+        FDS_OPTS_END};
+/** Definition of the \<fields>\*/
+static const struct fds_xml_args args_fields[] = {
+        FDS_OPTS_ATTR(FIELDS_INCLUDE, "include", FDS_OPTS_T_STRING,
+                      FDS_OPTS_P_OPT),
+        FDS_OPTS_ATTR(FIELDS_EXCLUDE, "exclude", FDS_OPTS_T_STRING,
+                      FDS_OPTS_P_OPT),
         FDS_OPTS_END};
 /** Definition of the \<params>\*/
 static const struct fds_xml_args args_params[] = {
@@ -118,6 +317,13 @@ static const struct fds_xml_args args_params[] = {
                       FDS_OPTS_P_OPT),
         FDS_OPTS_ELEM(FMT_BFSPLIT, "splitBiflow", FDS_OPTS_T_BOOL,
                       FDS_OPTS_P_OPT),
+        FDS_OPTS_NESTED(FMT_FIELDS, "fields", args_fields, FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(FMT_OUTPUT, "outputFormat", FDS_OPTS_T_STRING,
+                      FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(FMT_SCHEMA_DIR, "schemaRegistryDir", FDS_OPTS_T_STRING,
+                      FDS_OPTS_P_OPT),
+        FDS_OPTS_ELEM(FMT_COMPACT, "compact", FDS_OPTS_T_BOOL,
+                      FDS_OPTS_P_OPT),
         FDS_OPTS_NESTED(KAFKA, "kafka", args_kafka, FDS_OPTS_P_OPT),
         FDS_OPTS_NESTED(PROCESSING, "processing", args_processing,
                         FDS_OPTS_P_OPT),
@@ -154,6 +360,27 @@ private:
      */
     void parseProcessing(fds_xml_ctx_t *parser);
 
+    /**
+     * \brief Parse "fields" parameters
+     * @param fields[in]
+     * @throw invalid_argument
+     */
+    void parseFields(fds_xml_ctx_t *fields);
+
+    /**
+     * \brief Parse "route" parameters
+     * @param route[in]
+     * @throw invalid_argument
+     */
+    void parseRoute(fds_xml_ctx_t *route);
+
+    /**
+     * \brief Parse "property" parameters
+     * @param property[in]
+     * @throw invalid_argument
+     */
+    void parseProperty(fds_xml_ctx_t *property);
+
     bool check_or(const std::string &elem, const char *value,
                   const std::string &val_true,
                   const std::string &val_false);
@@ -0,0 +1,124 @@
+#include "FieldTables.h"
+
+namespace {
+
+constexpr uint8_t length(const char *text) {
+    uint8_t len = 0;
+    while (text[len] != '\0') {
+        len++;
+    }
+    return len;
+}
+
+constexpr FieldTables::Name name(const char *text) {
+    return {text, text ? length(text) : uint8_t(0)};
+}
+
+//keywords of protocols written by fds_drec2json, nullptr for values
+//converted by fds_drec2json itself
+constexpr const char *protocolKeywords[256] = {
+
+        "HOPOPT", "ICMP", "IGMP", "GGP", "IPv4", "ST", "TCP", "CBT", "EGP",
+        "IGP", "BBN-RCC-MON", "NVP-II", "PUP", "ARGUS", "EMCON", "XNET",
+        "CHAOS", "UDP", "MUX", "DCN-MEAS", "HMP", "PRM", "XNS-IDP",
+        "TRUNK-1", "TRUNK-2", "LEAF-1", "LEAF-2", "RDP", "IRTP", "ISO-TP4",
+        "NETBLT", "MFE-NSP", "MERIT-INP", "DCCP", "3PC", "IDPR", "XTP",
+        "DDP", "IDPR-CMTP", "TP++", "IL", "IPv6", "SDRP", "IPv6-Route",
+        "IPv6-Frag", "IDRP", "RSVP", "GRE", "DSR", "BNA", "ESP", "AH",
+        "I-NLSP", "SWIPE", "NARP", nullptr, "TLSP", "SKIP", "IPv6-ICMP",
+        "IPv6-NoNxt", "IPv6-Opts", nullptr, "CFTP", nullptr, "SAT-EXPAK",
+        "KRYPTOLAN", "RVD", "IPPC", nullptr, "SAT-MON", "VISA", "IPCV",
+        "CPNX", "CPHB", "WSN", "PVP", "BR-SAT-MON", "SUN-ND", "WB-MON",
+        "WB-EXPAK", "ISO-IP", "VMTP", "SECURE-VMTP", "VINES", nullptr,
+        "NSFNET-IGP", "DGP", "TCF", "EIGRP", "OSPFIGP", "Sprite-RPC",
+        "LARP", "MTP", "AX.25", "IPIP", "MICP", "SCC-SP", "ETHERIP",
+        "ENCAP", nullptr, "GMTP", "IFMP", "PNNI", "PIM", "ARIS", "SCPS",
+        "QNX", "A/N", "IPComp", "SNP", "Compaq-Peer", "IPX-in-IP", "VRRP",
+        "PGM", nullptr, "L2TP", "DDX", "IATP", "STP", "SRP", "UTI", "SMP",
+        "SM", "PTP", nullptr, "FIRE", "CRTP", "CRUDP", "SSCOPMCE", "IPLT",
+        "SPS", "PIPE", "SCTP", "FC", "RSVP-E2E-IGNORE", nullptr, "UDPLite",
+        "MPLS-in-IP", "manet", "HIP", "Shim6", "WESP", "ROHC"};
+
+struct ProtocolTable {
+    FieldTables::Name names[256];
+
+    constexpr ProtocolTable() : names() {
+        for (uint32_t i = 0; i < 256; i++) {
+            names[i] = name(protocolKeywords[i]);
+        }
+    }
+};
+
+constexpr ProtocolTable protocolTable;
+
+//lowercase hexadecimal word without leading zeros
+inline char *writeWord(uint32_t word, char *out) {
+    const char digits[] = "0123456789abcdef";
+    int shift = 12;
+    while (shift > 0 && (word >> shift) == 0) {
+        shift -= 4;
+    }
+    for (; shift >= 0; shift -= 4) {
+        *out++ = digits[(word >> shift) & 0xF];
+    }
+    return out;
+}
+
+} // namespace
+
+namespace FieldTables {
+
+const Name *const protocols = protocolTable.names;
+
+char *writeIpv6(const uint8_t *addr, char *out) {
+    uint32_t words[8];
+    for (uint32_t i = 0; i < 8; i++) {
+        words[i] = uint32_t(addr[2 * i]) << 8 | addr[2 * i + 1];
+    }
+
+    //first longest run of at least two zero words
+    int bestBase = -1;
+    int bestLength = 0;
+    for (int i = 0; i < 8;) {
+        if (words[i] != 0) {
+            i++;
+            continue;
+        }
+        int end = i;
+        while (end < 8 && words[end] == 0) {
+            end++;
+        }
+        if (end - i > bestLength) {
+            bestBase = i;
+            bestLength = end - i;
+        }
+        i = end;
+    }
+    if (bestLength < 2) {
+        bestBase = -1;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        if (bestBase != -1 && i >= bestBase && i < bestBase + bestLength) {
+            if (i == bestBase) {
+                *out++ = ':';
+            }
+            continue;
+        }
+        if (i != 0) {
+            *out++ = ':';
+        }
+        //IPv4-compatible and IPv4-mapped addresses
+        if (i == 6 && bestBase == 0 &&
+            (bestLength == 6 || (bestLength == 5 && words[5] == 0xFFFF))) {
+            return writeIpv4(addr + 12, out);
+        }
+        out = writeWord(words[i], out);
+    }
+    if (bestBase != -1 && bestBase + bestLength == 8) {
+        *out++ = ':';
+    }
+    return out;
+}
+
+} // namespace FieldTables
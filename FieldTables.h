@@ -0,0 +1,138 @@
+#ifndef FIELD_TABLES_H
+#define FIELD_TABLES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * \brief Lookup tables for formatted IPFIX fields
+ *
+ * Tables are generated at compile time, so TCP flags, protocol names, IPv4
+ * and MAC addresses are formatted by copying few bytes per field. Output is
+ * identical to fds_drec2json (FDS_CD2J_FORMAT_TCPFLAGS,
+ * FDS_CD2J_FORMAT_PROTO) and fds_ip2str / fds_mac2str.
+ */
+namespace FieldTables {
+
+/** text of 0 - 255 (left aligned) with its length */
+struct Octet {
+    char text[3];
+    uint8_t length;
+};
+
+/** name of protocol with its length */
+struct Name {
+    const char *text;
+    uint8_t length;
+};
+
+/** TCP flags of the low byte as "UAPRSF" with '.' for unset flags */
+struct TcpFlagsTable {
+    char text[256][6];
+
+    constexpr TcpFlagsTable() : text() {
+        const char names[] = "UAPRSF";
+        for (uint32_t flags = 0; flags < 256; flags++) {
+            for (uint32_t i = 0; i < 6; i++) {
+                text[flags][i] = (flags & (0x20 >> i)) ? names[i] : '.';
+            }
+        }
+    }
+};
+
+/** decimal text of octets (IPv4 addresses) */
+struct OctetTable {
+    Octet octets[256];
+
+    constexpr OctetTable() : octets() {
+        for (uint32_t value = 0; value < 256; value++) {
+            Octet &octet = octets[value];
+            octet.text[1] = '\0';
+            octet.text[2] = '\0';
+            if (value >= 100) {
+                octet.text[0] = char('0' + value / 100);
+                octet.text[1] = char('0' + value / 10 % 10);
+                octet.text[2] = char('0' + value % 10);
+                octet.length = 3;
+            } else if (value >= 10) {
+                octet.text[0] = char('0' + value / 10);
+                octet.text[1] = char('0' + value % 10);
+                octet.length = 2;
+            } else {
+                octet.text[0] = char('0' + value);
+                octet.length = 1;
+            }
+        }
+    }
+};
+
+/** two hexadecimal digits of bytes (MAC addresses) */
+struct HexTable {
+    char text[256][2];
+
+    constexpr HexTable() : text() {
+        const char digits[] = "0123456789ABCDEF";
+        for (uint32_t value = 0; value < 256; value++) {
+            text[value][0] = digits[value >> 4];
+            text[value][1] = digits[value & 0xF];
+        }
+    }
+};
+
+constexpr TcpFlagsTable tcpFlags;
+constexpr OctetTable octets;
+constexpr HexTable hex;
+
+/** names of protocols, nullptr for values left to fds_drec2json */
+extern const Name *const protocols;
+
+/** maximal length of IPv6 address text                                    */
+constexpr size_t MAX_IPV6_LENGTH = 45;
+
+/**
+ * \brief Write IPv4 address in dotted decimal form
+ * @param[in] addr address (4 bytes)
+ * @param[out] out output (at least 16 chars)
+ * @return end of written chars
+ */
+inline char *writeIpv4(const uint8_t *addr, char *out) {
+    for (uint32_t i = 0; i < 4; i++) {
+        //whole entry is copied, only the length is kept
+        const Octet &octet = octets.octets[addr[i]];
+        memcpy(out, octet.text, 3);
+        out += octet.length;
+        *out++ = '.';
+    }
+    return out - 1;
+}
+
+/**
+ * \brief Write MAC address as XX:XX:XX:XX:XX:XX
+ * @param[in] addr address (6 bytes)
+ * @param[out] out output (at least 17 chars)
+ * @return end of written chars
+ */
+inline char *writeMac(const uint8_t *addr, char *out) {
+    for (uint32_t i = 0; i < 6; i++) {
+        memcpy(out, hex.text[addr[i]], 2);
+        out[2] = ':';
+        out += 3;
+    }
+    return out - 1;
+}
+
+/**
+ * \brief Write IPv6 address in the form of inet_ntop
+ *
+ * The longest run of zero words is compressed (RFC 5952), IPv4-compatible
+ * and IPv4-mapped addresses end with dotted decimal IPv4 address.
+ * @param[in] addr address (16 bytes)
+ * @param[out] out output (at least MAX_IPV6_LENGTH chars)
+ * @return end of written chars
+ */
+char *writeIpv6(const uint8_t *addr, char *out);
+
+} // namespace FieldTables
+
+#endif // FIELD_TABLES_H
@@ -0,0 +1,705 @@
+#include "JsonConverter.h"
+#include "FieldTables.h"
+#include "Logger.h"
+#include "NumberFormat.h"
+#include "StringEscape.h"
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+//upper bound of chars of formatted value with data of the size
+inline size_t valueBound(size_t size) {
+    //escaped string (\u00XX) or hexadecimal octets, numbers and addresses
+    return 6 * size + 64;
+}
+
+//append JSON string (without quotes) with escaped quotes and backslashes
+void appendEscaped(std::string &out, const char *str) {
+    for (; *str != '\0'; str++) {
+        if (*str == '"' || *str == '\\') {
+            out += '\\';
+        }
+        out += *str;
+    }
+}
+
+//wrap result of libfds converter into quotes
+inline int quoted(int rc, char *out) {
+    if (rc < 0) {
+        return FDS_ERR_FORMAT;
+    }
+    out[0] = '"';
+    out[rc + 1] = '"';
+    return rc + 2;
+}
+
+/**
+ * Format value of the field, instantiated for each formatter
+ * @return number of written chars or FDS_ERR_FORMAT if the value is left to
+ * fds_drec2json
+ */
+template<JsonPlan::Format format>
+int formatValue(const JsonPlan::Field &field, const uint8_t *data,
+                uint16_t size, char *out, size_t outSize,
+                ConverterState *state) {
+    int rc;
+    switch (format) {
+        case JsonPlan::Format::OCTETS_UINT:
+            if (size >= 1 && size <= 8) {
+                return NumberFormat::writeUint(
+                        NumberFormat::readUintBe(data, size), out) - out;
+            }
+            //fall through
+        case JsonPlan::Format::OCTETS:
+            if (size == 0) {
+                return FDS_ERR_FORMAT;
+            }
+            out[0] = '"';
+            out[1] = '0';
+            out[2] = 'x';
+            rc = fds_octet_array2str(data, size, out + 3, outSize - 4);
+            if (rc < 0) {
+                return FDS_ERR_FORMAT;
+            }
+            out[rc + 3] = '"';
+            return rc + 4;
+        case JsonPlan::Format::UINT:
+            if (size < 1 || size > 8) {
+                return FDS_ERR_FORMAT;
+            }
+            return NumberFormat::writeUint(
+                    NumberFormat::readUintBe(data, size), out) - out;
+        case JsonPlan::Format::INT:
+            if (size < 1 || size > 8) {
+                return FDS_ERR_FORMAT;
+            }
+            return NumberFormat::writeInt(
+                    NumberFormat::readIntBe(data, size), out) - out;
+        case JsonPlan::Format::FLOAT:
+            //non-finite values are left to fds_drec2json
+            rc = NumberFormat::writeFloatBe(data, size, out, outSize);
+            return rc < 0 ? FDS_ERR_FORMAT : rc;
+        case JsonPlan::Format::BOOL: {
+            bool value;
+            if (fds_get_bool(data, size, &value) != FDS_OK) {
+                return FDS_ERR_FORMAT;
+            }
+            if (value) {
+                memcpy(out, "true", 4);
+                return 4;
+            }
+            memcpy(out, "false", 5);
+            return 5;
+        }
+        case JsonPlan::Format::DATETIME_STR:
+            if (field.type == FDS_ET_DATE_TIME_SECONDS ||
+                field.type == FDS_ET_DATE_TIME_MILLISECONDS) {
+                //exact in milliseconds, calendar part is cached per second
+                uint64_t value;
+                if (fds_get_datetime_lp_be(data, size, field.type, &value) !=
+                    FDS_OK) {
+                    return FDS_ERR_FORMAT;
+                }
+                rc = state->timestamps.write(value, out + 1);
+                if (rc >= 0) {
+                    return quoted(rc, out);
+                }
+            }
+            return quoted(fds_datetime2str_be(data, size, field.type, out + 1,
+                                              outSize - 2,
+                                              FDS_CONVERT_TF_MSEC_UTC), out);
+        case JsonPlan::Format::DATETIME_UNIX: {
+            uint64_t value;
+            if (fds_get_datetime_lp_be(data, size, field.type, &value) !=
+                FDS_OK) {
+                return FDS_ERR_FORMAT;
+            }
+            return NumberFormat::writeUint(value, out) - out;
+        }
+        case JsonPlan::Format::IP: {
+            char *end;
+            if (size == 4) {
+                end = FieldTables::writeIpv4(data, out + 1);
+            } else if (size == 16) {
+                end = FieldTables::writeIpv6(data, out + 1);
+            } else {
+                return FDS_ERR_FORMAT;
+            }
+            return quoted(end - out - 1, out);
+        }
+        case JsonPlan::Format::MAC: {
+            if (size != 6) {
+                return FDS_ERR_FORMAT;
+            }
+            return quoted(FieldTables::writeMac(data, out + 1) - out - 1, out);
+        }
+        case JsonPlan::Format::STRING: {
+            char *pos = out;
+            *pos++ = '"';
+            size_t i = 0;
+            for (;;) {
+                //clean runs are copied in bulk
+                const size_t run = StringEscape::find(data + i, size - i);
+                memcpy(pos, data + i, run);
+                pos += run;
+                i += run;
+                if (i == size) {
+                    break;
+                }
+                const char escaped = StringEscape::shortEscape(data[i++]);
+                if (escaped == 0) {
+                    //control and non-ASCII chars are left to fds_drec2json
+                    return FDS_ERR_FORMAT;
+                }
+                *pos++ = '\\';
+                *pos++ = escaped;
+            }
+            *pos++ = '"';
+            return pos - out;
+        }
+        case JsonPlan::Format::TCP_FLAGS: {
+            if (size != 1 && size != 2) {
+                return FDS_ERR_FORMAT;
+            }
+            out[0] = '"';
+            memcpy(out + 1, FieldTables::tcpFlags.text[data[size - 1]], 6);
+            out[7] = '"';
+            return 8;
+        }
+        case JsonPlan::Format::PROTO: {
+            if (size != 1 || FieldTables::protocols[data[0]].text == nullptr) {
+                return FDS_ERR_FORMAT;
+            }
+            const FieldTables::Name &name = FieldTables::protocols[data[0]];
+            out[0] = '"';
+            memcpy(out + 1, name.text, name.length);
+            out[name.length + 1] = '"';
+            return name.length + 2;
+        }
+    }
+    return FDS_ERR_FORMAT;
+}
+
+//formatters in the order of JsonPlan::Format
+constexpr JsonPlan::Formatter formatters[] = {
+        formatValue<JsonPlan::Format::UINT>,
+        formatValue<JsonPlan::Format::INT>,
+        formatValue<JsonPlan::Format::FLOAT>,
+        formatValue<JsonPlan::Format::BOOL>,
+        formatValue<JsonPlan::Format::DATETIME_STR>,
+        formatValue<JsonPlan::Format::DATETIME_UNIX>,
+        formatValue<JsonPlan::Format::IP>,
+        formatValue<JsonPlan::Format::MAC>,
+        formatValue<JsonPlan::Format::STRING>,
+        formatValue<JsonPlan::Format::OCTETS>,
+        formatValue<JsonPlan::Format::OCTETS_UINT>,
+        formatValue<JsonPlan::Format::TCP_FLAGS>,
+        formatValue<JsonPlan::Format::PROTO>};
+
+static_assert(sizeof(formatters) / sizeof(formatters[0]) ==
+              size_t(JsonPlan::Format::PROTO) + 1,
+              "Formatter is missing");
+
+//end of JSON value which begins at pos
+size_t skipValue(const char *data, size_t pos, size_t length) {
+    int depth = 0;
+    bool inString = false;
+    for (; pos < length; pos++) {
+        const char c = data[pos];
+        if (inString) {
+            if (c == '\\') {
+                pos++;
+            } else if (c == '"') {
+                inString = false;
+                if (depth == 0) {
+                    return pos + 1;
+                }
+            }
+            continue;
+        }
+        switch (c) {
+            case '"':
+                inString = true;
+                break;
+            case '{':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ']':
+                if (depth == 0) {
+                    return pos;
+                }
+                if (--depth == 0) {
+                    return pos + 1;
+                }
+                break;
+            case ',':
+                if (depth == 0) {
+                    return pos;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return pos;
+}
+
+/**
+ * Remove members with dropped keys from JSON object of fds_drec2json
+ * (without white spaces)
+ * @return new length of the object
+ */
+size_t filterMembers(char *data, size_t length,
+                     const std::unordered_set<std::string> &dropped) {
+    size_t out = 1;
+    size_t pos = 1;
+    bool first = true;
+    std::string key;
+    while (pos < length && data[pos] == '"') {
+        const size_t keyBegin = pos + 1;
+        size_t keyEnd = keyBegin;
+        while (keyEnd < length && data[keyEnd] != '"') {
+            keyEnd += data[keyEnd] == '\\' ? 2 : 1;
+        }
+        //value follows the colon
+        const size_t valueEnd = skipValue(data, keyEnd + 2, length);
+
+        key.assign(data + keyBegin, keyEnd - keyBegin);
+        if (dropped.count(key) == 0) {
+            if (!first) {
+                data[out++] = ',';
+            }
+            memmove(data + out, data + pos, valueEnd - pos);
+            out += valueEnd - pos;
+            first = false;
+        }
+        pos = valueEnd;
+        if (pos < length && data[pos] == ',') {
+            pos++;
+        }
+    }
+    data[out++] = '}';
+    return out;
+}
+
+/**
+ * Append values of JSON object of fds_drec2json (without white spaces) to
+ * compact record, in order of members, except "@type"
+ * @return number of appended values
+ */
+size_t compactMembers(const char *data, size_t length,
+                      std::vector<char> &out) {
+    size_t values = 0;
+    size_t pos = 1;
+    while (pos < length && data[pos] == '"') {
+        const size_t keyBegin = pos + 1;
+        size_t keyEnd = keyBegin;
+        while (keyEnd < length && data[keyEnd] != '"') {
+            keyEnd += data[keyEnd] == '\\' ? 2 : 1;
+        }
+        const size_t valueBegin = keyEnd + 2;
+        const size_t valueEnd = skipValue(data, valueBegin, length);
+
+        if (keyEnd - keyBegin != 5 || memcmp(data + keyBegin, "@type", 5)) {
+            out.push_back(',');
+            out.insert(out.end(), data + valueBegin, data + valueEnd);
+            values++;
+        }
+        pos = valueEnd;
+        if (pos < length && data[pos] == ',') {
+            pos++;
+        }
+    }
+    return values;
+}
+
+} // namespace
+
+JsonConverter::JsonConverter(std::shared_ptr<ConfigFormat> configFormat,
+                             std::shared_ptr<ConfigProcessing>
+                             configProcessing,
+                             TemplateSink templateSink)
+        : RecordConverter(configFormat) {
+    compiled = configProcessing->compiledConversion;
+    verifyRecords = configProcessing->verifyConversion;
+    compact = configFormat->compact;
+    this->templateSink = templateSink;
+
+    //records are appended into output buffers, which grow on their own
+    flags = 0;
+    if (configFormat->tcp_flags) {
+        flags |= FDS_CD2J_FORMAT_TCPFLAGS;
+    }
+    if (configFormat->timestamp) {
+        flags |= FDS_CD2J_TS_FORMAT_MSEC;
+    }
+    if (configFormat->proto) {
+        flags |= FDS_CD2J_FORMAT_PROTO;
+    }
+    if (configFormat->ignore_unknown) {
+        flags |= FDS_CD2J_IGNORE_UNKNOWN;
+    }
+    if (!configFormat->white_spaces) {
+        flags |= FDS_CD2J_NON_PRINTABLE;
+    }
+    if (configFormat->numeric_names) {
+        flags |= FDS_CD2J_NUMERIC_ID;
+    }
+    if (configFormat->split_biflow) {
+        flags |= FDS_CD2J_REVERSE_SKIP;
+    }
+    if (!configFormat->octets_as_uint) {
+        flags |= FDS_CD2J_OCTETS_NOINT;
+    }
+}
+
+std::unique_ptr<JsonPlan>
+JsonConverter::compile(const fds_template *tmplt, uint32_t odid) const {
+    std::unique_ptr<JsonPlan> plan = std::make_unique<JsonPlan>();
+    plan->generic = false;
+    plan->dynamic = (tmplt->flags & FDS_TEMPLATE_DYNAMIC) != 0;
+    plan->prefix = "{\"@type\":\"ipfix.entry\"";
+    plan->close = '}';
+    plan->verifyLeft = verifyRecords;
+    plan->mismatch = false;
+
+    //keys of dropped fields, for records converted by fds_drec2json
+    if (configFormat->projection != FIELDS_ALL) {
+        for (uint16_t i = 0; i < tmplt->fields_cnt_total; i++) {
+            if (!isSelected(tmplt->fields[i])) {
+                plan->dropped.insert(keyName(tmplt->fields[i]));
+            }
+        }
+    }
+
+    if (tmplt->type != FDS_TYPE_TEMPLATE ||
+        (tmplt->flags & (FDS_TEMPLATE_BIFLOW | FDS_TEMPLATE_MULTI_IE))) {
+        plan->generic = true;
+        return plan;
+    }
+
+    for (uint16_t i = 0; i < tmplt->fields_cnt_total; i++) {
+        const fds_tfield &tfield = tmplt->fields[i];
+        const fds_iemgr_elem *def = tfield.def;
+        if (tfield.en == 0 && tfield.id == 210) {
+            //paddingOctets are hidden by the record iterator
+            continue;
+        }
+        if (def == nullptr && configFormat->ignore_unknown) {
+            continue;
+        }
+        if (!isSelected(tfield)) {
+            continue;
+        }
+
+        JsonPlan::Field field;
+        field.index = i;
+        field.offset = tfield.offset;
+        field.length = tfield.length;
+        field.type = def ? def->data_type : FDS_ET_OCTET_ARRAY;
+        field.key = ",\"" + keyName(tfield) + "\":";
+
+        switch (field.type) {
+            case FDS_ET_UNSIGNED_8:
+            case FDS_ET_UNSIGNED_16:
+            case FDS_ET_UNSIGNED_32:
+            case FDS_ET_UNSIGNED_64:
+                if (configFormat->tcp_flags && tfield.en == 0 &&
+                    tfield.id == 6) {
+                    field.format = JsonPlan::Format::TCP_FLAGS;
+                } else if (configFormat->proto && tfield.en == 0 &&
+                           tfield.id == 4) {
+                    field.format = JsonPlan::Format::PROTO;
+                } else {
+                    field.format = JsonPlan::Format::UINT;
+                }
+                break;
+            case FDS_ET_SIGNED_8:
+            case FDS_ET_SIGNED_16:
+            case FDS_ET_SIGNED_32:
+            case FDS_ET_SIGNED_64:
+                field.format = JsonPlan::Format::INT;
+                break;
+            case FDS_ET_FLOAT_32:
+            case FDS_ET_FLOAT_64:
+                field.format = JsonPlan::Format::FLOAT;
+                break;
+            case FDS_ET_BOOLEAN:
+                field.format = JsonPlan::Format::BOOL;
+                break;
+            case FDS_ET_MAC_ADDRESS:
+                field.format = JsonPlan::Format::MAC;
+                break;
+            case FDS_ET_STRING:
+                field.format = JsonPlan::Format::STRING;
+                break;
+            case FDS_ET_DATE_TIME_SECONDS:
+            case FDS_ET_DATE_TIME_MILLISECONDS:
+            case FDS_ET_DATE_TIME_MICROSECONDS:
+            case FDS_ET_DATE_TIME_NANOSECONDS:
+                field.format = configFormat->timestamp
+                               ? JsonPlan::Format::DATETIME_STR
+                               : JsonPlan::Format::DATETIME_UNIX;
+                break;
+            case FDS_ET_IPV4_ADDRESS:
+            case FDS_ET_IPV6_ADDRESS:
+                field.format = JsonPlan::Format::IP;
+                break;
+            case FDS_ET_OCTET_ARRAY:
+                field.format = configFormat->octets_as_uint
+                               ? JsonPlan::Format::OCTETS_UINT
+                               : JsonPlan::Format::OCTETS;
+                break;
+            default:
+                //lists and unassigned types
+                plan->generic = true;
+                plan->fields.clear();
+                return plan;
+        }
+        field.formatter = formatters[size_t(field.format)];
+        plan->fields.push_back(field);
+    }
+
+    if (compact) {
+        compactPlan(plan.get(), tmplt, odid);
+    }
+    return plan;
+}
+
+void JsonConverter::compactPlan(JsonPlan *plan, const fds_template *tmplt,
+                                uint32_t odid) const {
+    //names of fields in order of values
+    std::string names;
+    for (const JsonPlan::Field &field : plan->fields) {
+        if (!names.empty()) {
+            names += ',';
+        }
+        names += '"' + keyName(tmplt->fields[field.index]) + '"';
+    }
+
+    //FNV-1a, the key changes with the definition of the template
+    uint32_t hash = 2166136261U;
+    for (char c : names) {
+        hash = (hash ^ uint8_t(c)) * 16777619U;
+    }
+    char hex[9];
+    snprintf(hex, sizeof(hex), "%08x", hash);
+    const std::string key = std::to_string(odid) + ":" +
+                            std::to_string(tmplt->id) + ":" + hex;
+
+    plan->prefix = "[\"" + key + "\"";
+    plan->close = ']';
+    for (JsonPlan::Field &field : plan->fields) {
+        field.key = ",";
+    }
+    //arrays cannot be cross-checked against fds_drec2json
+    plan->verifyLeft = 0;
+
+    std::lock_guard<std::mutex> lock(publishedMtx);
+    if (!templateSink || !published.insert(key).second) {
+        return;
+    }
+    const std::string value =
+            "{\"@type\":\"ipfix.template\",\"odid\":" + std::to_string(odid) +
+            ",\"templateId\":" + std::to_string(tmplt->id) + ",\"key\":\"" +
+            key + "\",\"fields\":[" + names + "]}";
+    //plans are compiled once per template, the sink itself sends the
+    //template again until it is delivered
+    if (!templateSink(key, value)) {
+        Logger::logWarning("Template " + key + " is not published yet");
+    }
+}
+
+std::string JsonConverter::keyName(const fds_tfield &tfield) const {
+    const fds_iemgr_elem *def = tfield.def;
+    if (def == nullptr || configFormat->numeric_names) {
+        return "en" + std::to_string(tfield.en) + ":id" +
+               std::to_string(tfield.id);
+    }
+    std::string key;
+    appendEscaped(key, def->scope->name);
+    key += ':';
+    appendEscaped(key, def->name);
+    return key;
+}
+
+int JsonConverter::convert(const SharedTemplate *shared, fds_drec *rec,
+                           const fds_iemgr_t *iemgr, OutputBuffer *buffer,
+                           ConverterState *state) const {
+    //plans are compiled even for generic conversion, they hold projection
+    std::call_once(shared->planFlag, [this, shared]() {
+        shared->plan = compile(shared->tmplt, shared->odid);
+    });
+    const JsonPlan *plan = static_cast<const JsonPlan *>(shared->plan.get());
+    if (!compiled || plan->generic ||
+        plan->mismatch.load(std::memory_order_relaxed)) {
+        return convertGeneric(plan, rec, iemgr, buffer);
+    }
+
+    const size_t start = buffer->length;
+    const int rc = plan->dynamic ? convertPlan<true>(plan, rec, buffer, state)
+                                 : convertPlan<false>(plan, rec, buffer,
+                                                      state);
+    if (rc == FDS_ERR_FORMAT) {
+        //value not covered by the plan
+        buffer->length = start;
+        state->valueFallbacks++;
+        if (compact) {
+            return convertCompactGeneric(plan, rec, iemgr, buffer, state);
+        }
+        return convertGeneric(plan, rec, iemgr, buffer);
+    }
+    if (rc < 0) {
+        buffer->length = start;
+        return rc;
+    }
+
+    if (plan->verifyLeft.load(std::memory_order_relaxed) > 0 &&
+        plan->verifyLeft.fetch_sub(1, std::memory_order_relaxed) > 0 &&
+        !verify(plan, rec, iemgr, buffer->data + start, rc, state)) {
+        buffer->length = start;
+        return convertGeneric(plan, rec, iemgr, buffer);
+    }
+    return rc;
+}
+
+template<bool dynamic>
+int JsonConverter::convertPlan(const JsonPlan *plan, fds_drec *rec,
+                               OutputBuffer *buffer,
+                               ConverterState *state) const {
+    const size_t start = buffer->length;
+    if (dynamic) {
+        collectFields(rec, state);
+    }
+
+    if (!buffer->reserve(plan->prefix.size())) {
+        return FDS_ERR_NOMEM;
+    }
+    memcpy(buffer->data + buffer->length, plan->prefix.data(),
+           plan->prefix.size());
+    buffer->length += plan->prefix.size();
+
+    for (const JsonPlan::Field &field : plan->fields) {
+        const uint8_t *data;
+        uint16_t size;
+        if (dynamic) {
+            data = state->fields[field.index].data;
+            size = state->fields[field.index].size;
+        } else {
+            data = rec->data + field.offset;
+            size = field.length;
+        }
+
+        if (!buffer->reserve(field.key.size() + valueBound(size))) {
+            return FDS_ERR_NOMEM;
+        }
+        char *pos = buffer->data + buffer->length;
+        memcpy(pos, field.key.data(), field.key.size());
+        pos += field.key.size();
+
+        const int rc = field.formatter(field, data, size, pos,
+                                       buffer->size - (pos - buffer->data),
+                                       state);
+        if (rc < 0) {
+            return rc;
+        }
+        buffer->length += field.key.size() + rc;
+    }
+
+    if (!buffer->reserve(1)) {
+        return FDS_ERR_NOMEM;
+    }
+    buffer->data[buffer->length++] = plan->close;
+    return buffer->length - start;
+}
+
+int JsonConverter::convertGeneric(const JsonPlan *plan, fds_drec *rec,
+                                  const fds_iemgr_t *iemgr,
+                                  OutputBuffer *buffer) const {
+    //record conversion, the buffer grows until the record fits
+    for (;;) {
+        char *tail = buffer->data + buffer->length;
+        size_t tailSize = buffer->size - buffer->length;
+        int rc = fds_drec2json(rec, flags, iemgr, &tail, &tailSize);
+        if (rc >= 0) {
+            if (!plan->dropped.empty()) {
+                rc = filterMembers(tail, rc, plan->dropped);
+            }
+            buffer->length += rc;
+            return rc;
+        }
+        if (rc != FDS_ERR_BUFFER) {
+            return rc;
+        }
+        if (!buffer->reserve(buffer->size - buffer->length + 1)) {
+            return FDS_ERR_NOMEM;
+        }
+    }
+}
+
+int JsonConverter::convertCompactGeneric(const JsonPlan *plan, fds_drec *rec,
+                                         const fds_iemgr_t *iemgr,
+                                         OutputBuffer *buffer,
+                                         ConverterState *state) const {
+    const size_t start = buffer->length;
+    const int rc = convertGeneric(plan, rec, iemgr, buffer);
+    if (rc < 0) {
+        return rc;
+    }
+
+    //records of one template key have one shape, values of the object are
+    //in the order of fields of the plan
+    std::vector<char> &record = state->check;
+    record.assign(plan->prefix.begin(), plan->prefix.end());
+    const size_t values = compactMembers(buffer->data + start, rc, record);
+    record.push_back(plan->close);
+    buffer->length = start;
+    if (values != plan->fields.size()) {
+        return FDS_ERR_FORMAT;
+    }
+    if (!buffer->reserve(record.size())) {
+        return FDS_ERR_NOMEM;
+    }
+    memcpy(buffer->data + start, record.data(), record.size());
+    buffer->length += record.size();
+    return record.size();
+}
+
+bool JsonConverter::verify(const JsonPlan *plan, fds_drec *rec,
+                           const fds_iemgr_t *iemgr, const char *converted,
+                           size_t length, ConverterState *state) const {
+    if (state->check.size() < length + 64) {
+        state->check.resize(length + 64);
+    }
+
+    int rc;
+    for (;;) {
+        char *data = state->check.data();
+        size_t size = state->check.size();
+        rc = fds_drec2json(rec, flags, iemgr, &data, &size);
+        if (rc != FDS_ERR_BUFFER) {
+            break;
+        }
+        state->check.resize(state->check.size() * 2);
+    }
+    if (rc >= 0 && !plan->dropped.empty()) {
+        rc = filterMembers(state->check.data(), rc, plan->dropped);
+    }
+
+    if (rc == (int) length && memcmp(state->check.data(), converted,
+                                     length) == 0) {
+        return true;
+    }
+
+    if (!plan->mismatch.exchange(true)) {
+        Logger::logWarning("Compiled conversion of template " +
+                           std::to_string(rec->tmplt->id) +
+                           " differs from fds_drec2json, the template is "
+                           "converted by fds_drec2json");
+    }
+    return false;
+}
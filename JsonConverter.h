@@ -0,0 +1,205 @@
+#ifndef JSON_CONVERTER_H
+#define JSON_CONVERTER_H
+
+#include <ipfixcol2.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "RecordConverter.h"
+
+/**
+ * \brief Conversion plan of one template
+ *
+ * Compiled on the first record of the template. Holds pre-escaped keys and
+ * the chosen formatter of every emitted field, so records are converted by
+ * walking the plan without resolving IE definitions and flags again.
+ */
+class JsonPlan final : public TemplatePlan {
+public:
+    /** Formatter of field value */
+    enum class Format : uint8_t {
+        UINT,          /**< unsigned integer                               */
+        INT,           /**< signed integer                                 */
+        FLOAT,         /**< float                                          */
+        BOOL,          /**< boolean                                        */
+        DATETIME_STR,  /**< ISO 8601 timestamp in milliseconds             */
+        DATETIME_UNIX, /**< unix timestamp in milliseconds                 */
+        IP,            /**< IPv4 / IPv6 address                            */
+        MAC,           /**< MAC address                                    */
+        STRING,        /**< string                                         */
+        OCTETS,        /**< octet array as hexadecimal string              */
+        OCTETS_UINT,   /**< octet array as unsigned integer if size <= 8   */
+        TCP_FLAGS,     /**< formatted TCP flags                            */
+        PROTO          /**< formatted protocol                             */
+    };
+
+    struct Field;
+
+    /**
+     * Formatter of field value specialized for one format
+     * @return number of written chars or FDS_ERR_FORMAT if the value is left
+     * to fds_drec2json
+     */
+    typedef int (*Formatter)(const Field &field, const uint8_t *data,
+                             uint16_t size, char *out, size_t outSize,
+                             ConverterState *state);
+
+    /** Emitted field */
+    struct Field {
+        /** index of the field in template                                 */
+        uint16_t index;
+        /** offset of the field in record (static templates only)          */
+        uint16_t offset;
+        /** length of the field (static templates only)                    */
+        uint16_t length;
+        /** format of the value                                            */
+        Format format;
+        /** formatter of the format (resolved when the plan is compiled)   */
+        Formatter formatter;
+        /** data type of the field                                         */
+        fds_iemgr_element_type type;
+        /** pre-escaped key with separator, e.g. ,"iana:octetDeltaCount":
+         *  (only the separator in compact records)                        */
+        std::string key;
+    };
+
+    /** whole records are converted by fds_drec2json                       */
+    bool generic;
+    /** template has variable-length fields                                */
+    bool dynamic;
+    /** beginning of the record (object, or array with key of template)    */
+    std::string prefix;
+    /** end of the record ('}' or ']')                                     */
+    char close;
+    /** emitted fields in template order                                   */
+    std::vector<Field> fields;
+    /** keys of fields dropped by projection (for fds_drec2json output)    */
+    std::unordered_set<std::string> dropped;
+
+    /** remaining records cross-checked against fds_drec2json              */
+    mutable std::atomic_int32_t verifyLeft;
+    /** cross-check failed, records are converted by fds_drec2json         */
+    mutable std::atomic_bool mismatch;
+};
+
+/**
+ * \brief Converter of IPFIX records to JSON
+ *
+ * Output is identical to fds_drec2json under the same configuration, except
+ * for fields dropped by the projection (\<fields>).
+ * Compact records (\<compact>) are arrays of values, the first item is the
+ * key of the template, which is published with names of fields once.
+ * Templates with features the plan does not cover (lists, biflow, multiple
+ * occurrences of one IE, Options Templates) and records with values the
+ * plan does not cover are converted by fds_drec2json. Such records of
+ * compact templates keep the compact form, only templates the plan does not
+ * cover are full objects.
+ */
+class JsonConverter final : public RecordConverter {
+public:
+    /**
+     * Publisher of templates of compact records, called once per key, so it
+     * keeps sending templates which are not enqueued or delivered
+     * @return false if the template was not enqueued yet
+     */
+    typedef std::function<bool(const std::string &key,
+                               const std::string &value)> TemplateSink;
+
+private:
+    //settings json format for libfds (fds_drec2json)
+    uint32_t flags;
+    //use compiled plans
+    bool compiled;
+    //records of each template cross-checked against fds_drec2json
+    uint32_t verifyRecords;
+    //records are arrays of values referencing templates
+    bool compact;
+    //publisher of templates of compact records
+    TemplateSink templateSink;
+    //keys of published templates
+    mutable std::mutex publishedMtx;
+    mutable std::unordered_set<std::string> published;
+
+    /**
+     * Compile plan of the template
+     * @param[in] tmplt template
+     * @param[in] odid observation domain ID of the template
+     * @return plan
+     */
+    std::unique_ptr<JsonPlan> compile(const fds_template *tmplt,
+                                      uint32_t odid) const;
+
+    /**
+     * Turn the plan into compact records and publish the template, unless
+     * the same template has already been published
+     * @param[in,out] plan plan of the template
+     * @param[in] tmplt template
+     * @param[in] odid observation domain ID of the template
+     */
+    void compactPlan(JsonPlan *plan, const fds_template *tmplt,
+                     uint32_t odid) const;
+
+    /**
+     * Convert record by the plan, instantiated for static and dynamic
+     * templates
+     * @return number of appended chars, FDS_ERR_FORMAT if the record is not
+     * covered by plan or other negative error code
+     */
+    template<bool dynamic>
+    int convertPlan(const JsonPlan *plan, fds_drec *rec,
+                    OutputBuffer *buffer, ConverterState *state) const;
+
+    /**
+     * Key of the field (escaped, without quotes)
+     */
+    std::string keyName(const fds_tfield &tfield) const;
+
+    /**
+     * Convert record by fds_drec2json, fields dropped by the plan are
+     * removed from the output
+     * @return number of appended chars or negative error code
+     */
+    int convertGeneric(const JsonPlan *plan, fds_drec *rec,
+                       const fds_iemgr_t *iemgr, OutputBuffer *buffer) const;
+
+    /**
+     * Convert record of compact plan by fds_drec2json, values of the object
+     * are rewritten into the compact record of the plan
+     * @return number of appended chars or negative error code
+     */
+    int convertCompactGeneric(const JsonPlan *plan, fds_drec *rec,
+                              const fds_iemgr_t *iemgr, OutputBuffer *buffer,
+                              ConverterState *state) const;
+
+    /**
+     * Compare converted record with output of fds_drec2json, disable the
+     * plan on mismatch
+     * @return false on mismatch
+     */
+    bool verify(const JsonPlan *plan, fds_drec *rec,
+                const fds_iemgr_t *iemgr, const char *converted,
+                size_t length, ConverterState *state) const;
+
+public:
+    /**
+     * \brief Constructor
+     *
+     * @param[in] configFormat configuration of the result JSON message
+     * @param[in] configProcessing configuration plugin
+     * @param[in] templateSink publisher of templates (compact records)
+     */
+    JsonConverter(std::shared_ptr<ConfigFormat> configFormat,
+                  std::shared_ptr<ConfigProcessing> configProcessing,
+                  TemplateSink templateSink = nullptr);
+
+    int convert(const SharedTemplate *shared, fds_drec *rec,
+                const fds_iemgr_t *iemgr, OutputBuffer *buffer,
+                ConverterState *state) const override;
+};
+
+#endif // JSON_CONVERTER_H
@@ -5,6 +5,7 @@
 #include <memory>
 
 #include "Config.h"
+#include "TemplateCache.h"
 #include "Worker.h"
 
 #include "Logger.h"
@@ -30,6 +31,8 @@ IPX_API struct ipx_plugin_info ipx_plugin_info = {
 struct InstanceData {
     /** Parsed configuration of the instance  */
     std::shared_ptr<Config> config;
+    /** Shared templates of records          */
+    TemplateCache templateCache;
 };
 
 //worker instance for covert ipfix records to json and export to
@@ -52,13 +55,21 @@ int ipx_plugin_init(ipx_ctx_t *ctx, const char *params) {
     worker = std::make_unique<Worker>(Worker(config->getConfigFormat(),
                                              config->getConfigKafka(),
                                              config->getConfigProcessing()));
-    //start worker threads
-    worker->start();
+    //start worker threads, rejected properties of producer deny the plugin
+    if (!worker->start()) {
+        worker.reset();
+        return IPX_ERR_DENIED;
+    }
 
     InstanceData *data = new InstanceData();
     data->config = std::make_shared<Config>(*config);
     ipx_ctx_private_set(ctx, data);
 
+    //session messages are needed to evict templates of closed sessions
+    const ipx_msg_mask_t mask = IPX_MSG_IPFIX | IPX_MSG_SESSION;
+    if (ipx_ctx_subscribe(ctx, &mask, nullptr) != IPX_OK) {
+        Logger::logWarning("Failed to subscribe to session messages");
+    }
 
     return IPX_OK;
 }
@@ -69,22 +80,17 @@ void ipx_plugin_destroy(ipx_ctx_t *ctx, void *cfg) {
     worker->stop();
     delete data;
 }
-//===========================================================================
-/*
-  Stolen method
-    ->/src/core/message_ipfix.c
-        ->171 - 193
-        ipx_msg_ipfix_add_drec_ref
- */
-struct ipx_ipfix_record *add_drec_ref(struct ipx_msg_ipfix **msg_ref) {
-    struct ipx_msg_ipfix *msg = *msg_ref;
-    const size_t offset = msg->rec_info.cnt_valid * msg->rec_info.rec_size;
-    msg->rec_info.cnt_valid++;
-    return ((struct ipx_ipfix_record *) (((uint8_t *) msg->recs) + offset));
-}
-//===========================================================================
-
 int ipx_plugin_process(ipx_ctx_t *ctx, void *cfg, ipx_msg_t *msg) {
+    InstanceData *data = reinterpret_cast<InstanceData *>(cfg);
+    if (ipx_msg_get_type(msg) == IPX_MSG_SESSION) {
+        ipx_msg_session_t *session = ipx_msg_base2session(msg);
+        if (ipx_msg_session_get_event(session) == IPX_MSG_SESSION_CLOSE) {
+            data->templateCache.removeSession(
+                    ipx_msg_session_get_session(session));
+        }
+        return IPX_OK;
+    }
+
     //get message
     ipx_msg_ipfix *m = ipx_msg_base2ipfix(msg);
     if (!m) {
@@ -92,35 +98,10 @@ int ipx_plugin_process(ipx_ctx_t *ctx, void *cfg, ipx_msg_t *msg) {
         return IPX_ERR_FORMAT;
     }
 
-    //create empty copy
-    ipx_msg_ipfix *copyMsg = ipx_msg_ipfix_create(ctx, &m->ctx, m->raw_pkt,
-                                                  m->raw_size);
-
-    //copy raw_pkt
-    copyMsg->raw_pkt = (uint8_t *) malloc(m->raw_size);
-    memcpy(copyMsg->raw_pkt, m->raw_pkt, m->raw_size);
-
-    copyMsg->msg_header.ref_cnt = m->msg_header.ref_cnt;
-
-    uint32_t recordSize = 0;
-    //copy record
-    for (int i = 0; i < m->rec_info.cnt_valid; i++) {
-
-        ipx_ipfix_record *rec = add_drec_ref(&copyMsg);
-        //ipx_ipfix_record* rec = ipx_msg_ipfix_add_drec_ref(&copyMsg); // symbol lookup error
-
-        ipx_ipfix_record *record = ipx_msg_ipfix_get_drec(m, i);
-        recordSize = record->rec.size;
-
-        rec->rec.size = recordSize;
-        rec->rec.data = (uint8_t *) malloc(recordSize);
-        rec->rec.tmplt = fds_template_copy(record->rec.tmplt);
-
-        memcpy(rec->rec.data, record->rec.data, recordSize);
-
-    }
-    //add copy message to plugin
-    worker->addMsg(std::move(std::make_unique<WorkerMsg>(WorkerMsg(
-            copyMsg, ipx_ctx_iemgr_get(ctx)))));
+    //borrow the message (or copy its records as fallback) and add it to
+    //plugin
+    worker->addMsg(std::make_unique<WorkerMsg>(
+            m, ipx_ctx_iemgr_get(ctx), data->templateCache,
+            data->config->getConfigProcessing()->zeroCopy));
     return IPX_OK;
 }
@@ -1,34 +1,81 @@
+#include <chrono>
 #include <cstring>
 #include "KafkaProducer.h"
 
+namespace {
+
+//period of shrinking idle pooled buffers
+constexpr std::chrono::seconds SWEEP_INTERVAL(1);
+//period of logged statistics
+constexpr std::chrono::minutes STATS_INTERVAL(1);
+//period of attempts to send failed templates again
+constexpr std::chrono::seconds TEMPLATE_RETRY_INTERVAL(1);
+
+} // namespace
 
 void KafkaProducer::dr_msg_cb(rd_kafka_t *rk,
                               const rd_kafka_message_t *rkmessage,
                               void *opaque) {
+    KafkaProducer *producer = reinterpret_cast<KafkaProducer *>(opaque);
+    //payload was not copied, return it to the pool (templates are copied)
+    if (rkmessage->_private != nullptr) {
+        producer->bufferPool->release(
+                reinterpret_cast<OutputBuffer *>(rkmessage->_private));
+    } else if (rkmessage->err) {
+        //records of the template cannot be decoded without it
+        const std::string key(reinterpret_cast<const char *>(rkmessage->key),
+                              rkmessage->key_len);
+        Logger::logError("Template " + key + " was not delivered (" +
+                         rd_kafka_err2str(rkmessage->err) +
+                         "), it is sent again");
+        producer->deferTemplate(
+                key, std::string(reinterpret_cast<const char *>(
+                                         rkmessage->payload),
+                                 rkmessage->len));
+    }
+
     if (rkmessage->err) {
-        fprintf(stderr, "%% Message delivery failed: %s\n",
-                rd_kafka_err2str(rkmessage->err));
+        producer->failedMessages.fetch_add(1, std::memory_order_relaxed);
     } else {
-        fprintf(stderr,
-                "%% Message delivered (%zd bytes, "
-                "partition %" PRId32 ")\n",
-                rkmessage->len, rkmessage->partition);
+        producer->deliveredMessages.fetch_add(1, std::memory_order_relaxed);
+        producer->deliveredBytes.fetch_add(rkmessage->len,
+                                           std::memory_order_relaxed);
     }
 
     /* The rkmessage is destroyed automatically by librdkafka */
 }
 
 KafkaProducer::KafkaProducer(std::string ip, std::string port,
-                             std::string topicList) {
+                             std::vector<std::string> topicNames,
+                             std::string templateTopic,
+                             std::vector<std::pair<std::string,
+                                     std::string>> properties,
+                             std::shared_ptr<BufferPool> bufferPool) {
     this->ip = ip;
     this->port = port;
-    this->topicList = topicList;
+    this->topicNames = topicNames;
+    this->templateTopic = templateTopic;
+    this->properties = properties;
+    this->bufferPool = bufferPool;
+    isPolling = false;
+    deliveredMessages = 0;
+    deliveredBytes = 0;
+    failedMessages = 0;
+    queueFullRetries = 0;
 }
 
 KafkaProducer::KafkaProducer(const KafkaProducer &kp) {
     ip = kp.ip;
     port = kp.port;
-    topicList = kp.topicList;
+    topicNames = kp.topicNames;
+    templateTopic = kp.templateTopic;
+    properties = kp.properties;
+    bufferPool = kp.bufferPool;
+    isPolling = false;
+    deliveredMessages = 0;
+    deliveredBytes = 0;
+    failedMessages = 0;
+    queueFullRetries = 0;
 }
 bool KafkaProducer::connect() {
     conf = rd_kafka_conf_new();
@@ -40,49 +87,108 @@ bool KafkaProducer::connect() {
     if (rd_kafka_conf_set(conf, "bootstrap.servers", broker.c_str(), errstr,
                           sizeof(errstr)) != RD_KAFKA_CONF_OK) {
 
-        Logger::logError("Failed to connect server");
-
+        Logger::logError(std::string("Failed to connect server: ") + errstr);
+        rd_kafka_conf_destroy(conf);
         return false;
     }
 
+    //keyed messages are placed like by the Java client, so consumers of
+    //both get the same partitions
+    if (rd_kafka_conf_set(conf, "partitioner", "murmur2_random", errstr,
+                          sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+        Logger::logError(std::string("Failed to set partitioner: ") +
+                         errstr);
+    }
+
+    //configured properties override defaults of the plugin
+    for (const auto &property : properties) {
+        if (rd_kafka_conf_set(conf, property.first.c_str(),
+                              property.second.c_str(), errstr,
+                              sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+            Logger::logError("Failed to set property " + property.first +
+                             "=" + property.second + ": " + errstr);
+            rd_kafka_conf_destroy(conf);
+            return false;
+        }
+    }
+
+    //callback and its opaque must be set before the configuration is
+    //passed to rd_kafka_new
+    rd_kafka_conf_set_dr_msg_cb(conf, KafkaProducer::dr_msg_cb);
+    rd_kafka_conf_set_opaque(conf, this);
 
     if (!(rk = rd_kafka_new(RD_KAFKA_PRODUCER, conf, errstr,
                             sizeof(errstr)))) {
 
-        Logger::logError("Failed to create new producer");
-
+        //conflicting properties are reported here (e.g. idempotence)
+        Logger::logError(std::string("Failed to create new producer: ") +
+                         errstr);
+        //configuration is owned by the producer only once it is created
+        rd_kafka_conf_destroy(conf);
         return false;
     }
 
-    rd_kafka_conf_set_dr_msg_cb(conf, KafkaProducer::dr_msg_cb);
+    //handles are looked up once, not by name for each message
+    for (const std::string &name : topicNames) {
+        rd_kafka_topic_t *rkt = rd_kafka_topic_new(rk, name.c_str(), nullptr);
+        if (rkt == nullptr) {
+            Logger::logError("Failed to create topic " + name + ": " +
+                             rd_kafka_err2str(rd_kafka_last_error()));
+            for (rd_kafka_topic_t *created : topics) {
+                rd_kafka_topic_destroy(created);
+            }
+            topics.clear();
+            rd_kafka_destroy(rk);
+            rk = nullptr;
+            return false;
+        }
+        topics.push_back(rkt);
+    }
+
+    //delivery reports are served continuously, not only on full queue
+    isPolling = true;
+    pollThread = std::thread(&KafkaProducer::poll, this);
     return true;
 }
 
-bool KafkaProducer::sendMessage(const char *message, const uint32_t len) {
-    char buf[len];
-    memmove(buf, message, len);
-
+bool KafkaProducer::sendMessage(OutputBuffer *buffer) {
     rd_kafka_resp_err_t err;
-    if (len == 0) {
-        /* Empty line: only serve delivery reports */
-        rd_kafka_poll(rk, 0 /*non-blocking */);
+    if (buffer->length == 0) {
+        bufferPool->release(buffer);
         return false;
     }
 
+    //encoding of compressed payload, owned by librdkafka once enqueued
+    rd_kafka_headers_t *headers = nullptr;
+    if (buffer->compressed) {
+        const std::string dictionaryId = std::to_string(buffer->dictionaryId);
+        headers = rd_kafka_headers_new(2);
+        rd_kafka_header_add(headers, "content-encoding", -1, "zstd", -1);
+        rd_kafka_header_add(headers, "zstd-dictionary-id", -1,
+                            dictionaryId.data(), dictionaryId.size());
+    }
+
     retry:
     err = rd_kafka_producev(
             /* Producer handle */
             rk,
-            /* Topic name */
-            RD_KAFKA_V_TOPIC(topicList.c_str()),
-            /* Make a copy of the payload. */
-            RD_KAFKA_V_MSGFLAGS(RD_KAFKA_MSG_F_COPY),
+            /* Topic handle selected by routes */
+            RD_KAFKA_V_RKT(topics[buffer->topic]),
+            /* Payload is neither copied nor freed by librdkafka, it is
+             * returned to the pool from the delivery report */
+            RD_KAFKA_V_MSGFLAGS(0),
             /* Message value and length */
-            RD_KAFKA_V_VALUE(buf, len),
+            RD_KAFKA_V_VALUE(buffer->data, buffer->length),
+            /* Key is copied by librdkafka, messages without key are
+             * spread over partitions */
+            RD_KAFKA_V_KEY(buffer->key.empty() ? nullptr : buffer->key.data(),
+                           buffer->key.size()),
+            /* Headers of compressed payload (or none) */
+            RD_KAFKA_V_HEADERS(headers),
             /* Per-Message opaque, provided in
              * delivery report callback as
              * msg_opaque. */
-            RD_KAFKA_V_OPAQUE(NULL),
+            RD_KAFKA_V_OPAQUE(buffer),
             /* End sentinel */
             RD_KAFKA_V_END);
 
@@ -91,8 +197,6 @@ bool KafkaProducer::sendMessage(const char *message, const uint32_t len) {
          * Failed to *enqueue* message for producing.
          */
 
-        Logger::logError("Failed to enqueue message for production");
-
         if (err == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
             /* If the internal queue is full, wait for
              * messages to be delivered and then retry.
@@ -103,19 +207,115 @@ bool KafkaProducer::sendMessage(const char *message, const uint32_t len) {
              *
              * The internal queue is limited by the
              * configuration property
-             * queue.buffering.max.messages */
-            rd_kafka_poll(rk, 1000 /*block for max 1000ms*/);
+             * queue.buffering.max.messages
+             * Delivery reports are served by the poll thread. */
+            queueFullRetries.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
             goto retry;
         }
-    } else {
-        //cout << "Enqueued message (" << len << " bytes) for topic " << topics.c_str() << endl;
+
+        Logger::logError(std::string(
+                "Failed to enqueue message for production: ") +
+                         rd_kafka_err2str(err));
+        failedMessages.fetch_add(1, std::memory_order_relaxed);
+        if (headers != nullptr) {
+            rd_kafka_headers_destroy(headers);
+        }
+        bufferPool->release(buffer);
+        return false;
     }
 
     return true;
 }
 
+rd_kafka_resp_err_t KafkaProducer::produceTemplate(const std::string &key,
+                                                   const std::string &value) {
+    return rd_kafka_producev(
+            rk,
+            RD_KAFKA_V_TOPIC(templateTopic.c_str()),
+            /* Templates are rare, librdkafka keeps its own copy */
+            RD_KAFKA_V_MSGFLAGS(RD_KAFKA_MSG_F_COPY),
+            RD_KAFKA_V_KEY(key.data(), key.size()),
+            RD_KAFKA_V_VALUE(const_cast<char *>(value.data()), value.size()),
+            /* No buffer, marks templates in delivery reports */
+            RD_KAFKA_V_OPAQUE(nullptr),
+            RD_KAFKA_V_END);
+}
+
+bool KafkaProducer::sendTemplate(const std::string &key,
+                                 const std::string &value) {
+    rd_kafka_resp_err_t err;
+    //templates are published once, they must not be dropped like records
+    //of a full queue
+    while ((err = produceTemplate(key, value)) ==
+           RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+        queueFullRetries.fetch_add(1, std::memory_order_relaxed);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (err) {
+        Logger::logError("Failed to enqueue template " + key + " (" +
+                         rd_kafka_err2str(err) + "), it is sent again");
+        failedMessages.fetch_add(1, std::memory_order_relaxed);
+        deferTemplate(key, value);
+        return false;
+    }
+    return true;
+}
+
+void KafkaProducer::deferTemplate(std::string key, std::string value) {
+    std::lock_guard<std::mutex> lock(pendingTemplatesMtx);
+    pendingTemplates.emplace_back(std::move(key), std::move(value));
+}
+
+void KafkaProducer::resendTemplates() {
+    std::vector<std::pair<std::string, std::string>> templates;
+    {
+        std::lock_guard<std::mutex> lock(pendingTemplatesMtx);
+        templates.swap(pendingTemplates);
+    }
+    //the poll thread serves delivery reports, it does not wait for room
+    //in the queue, failed templates are kept for the next attempt
+    for (auto &pending : templates) {
+        if (produceTemplate(pending.first, pending.second) !=
+            RD_KAFKA_RESP_ERR_NO_ERROR) {
+            deferTemplate(std::move(pending.first),
+                          std::move(pending.second));
+        }
+    }
+}
+
+void KafkaProducer::poll() {
+    auto lastSweep = std::chrono::steady_clock::now();
+    auto lastStats = lastSweep;
+    auto lastRetry = lastSweep;
+    while (isPolling) {
+        rd_kafka_poll(rk, 100 /*block for max 100ms*/);
+
+        //buffers idle in the pool are not seen by acquire and release
+        const auto now = std::chrono::steady_clock::now();
+        if (now - lastSweep >= SWEEP_INTERVAL) {
+            bufferPool->sweep();
+            lastSweep = now;
+        }
+        if (now - lastRetry >= TEMPLATE_RETRY_INTERVAL) {
+            resendTemplates();
+            lastRetry = now;
+        }
+        if (now - lastStats >= STATS_INTERVAL) {
+            logStats();
+            lastStats = now;
+        }
+    }
+}
+
 void KafkaProducer::disconnect() {
+    isPolling = false;
+    if (pollThread.joinable()) {
+        pollThread.join();
+    }
+
     Logger::logInfo("Flushing last message");
+    resendTemplates();
     rd_kafka_flush(rk, 10 * 1000 /* wait for max 10 seconds */);
 
     /* If the output queue is still not empty there is an issue
@@ -124,6 +324,35 @@ void KafkaProducer::disconnect() {
 
         Logger::logWarning("Message(s) were not delivered");
     }
+    {
+        std::lock_guard<std::mutex> lock(pendingTemplatesMtx);
+        if (!pendingTemplates.empty()) {
+            Logger::logWarning(std::to_string(pendingTemplates.size()) +
+                               " template(s) of compact records were not "
+                               "delivered");
+        }
+    }
+    logStats();
+    for (rd_kafka_topic_t *rkt : topics) {
+        rd_kafka_topic_destroy(rkt);
+    }
+    topics.clear();
     /* Destroy the producer instance */
     rd_kafka_destroy(rk);
 }
+
+void KafkaProducer::logStats() {
+    Logger::logInfo("Kafka producer: delivered " +
+                    std::to_string(deliveredMessages.load()) +
+                    " messages (" + std::to_string(deliveredBytes.load()) +
+                    " bytes), failed " +
+                    std::to_string(failedMessages.load()) +
+                    ", queue full retries " +
+                    std::to_string(queueFullRetries.load()));
+    Logger::logInfo("Buffer pool: " + bufferPool->stats());
+}
+
+uint64_t KafkaProducer::getReportedMessages() const {
+    return deliveredMessages.load(std::memory_order_relaxed) +
+           failedMessages.load(std::memory_order_relaxed);
+}
@@ -9,8 +9,13 @@
 #include <signal.h>
 #include <stdio.h>
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
+#include "BufferPool.h"
 #include "Logger.h"
 
 
@@ -23,17 +28,59 @@ class KafkaProducer final {
 private:
     std::string ip;
     std::string port;
-    // topics
-    rd_kafka_topic_partition_list_t *topics;
-    // list of topics separated by ','
-    std::string topicList = "";
+    // names of topics by index (default topic first)
+    std::vector<std::string> topicNames;
+    // handles of topics by index, created on connect
+    std::vector<rd_kafka_topic_t *> topics;
+    // topic of templates (compact records)
+    std::string templateTopic;
+    // properties of librdkafka (name, value)
+    std::vector<std::pair<std::string, std::string>> properties;
     // configuration
     rd_kafka_conf_t *conf;
     // handle
     rd_kafka_t *rk;
+    // pool of sent buffers, buffers return to it from delivery reports
+    std::shared_ptr<BufferPool> bufferPool;
+
+    // thread serving delivery reports
+    std::thread pollThread;
+    std::atomic_bool isPolling;
+
+    // delivery outcomes
+    std::atomic_uint64_t deliveredMessages;
+    std::atomic_uint64_t deliveredBytes;
+    std::atomic_uint64_t failedMessages;
+    std::atomic_uint64_t queueFullRetries;
+
+    // templates sent again by the poll thread (not enqueued or delivered)
+    std::mutex pendingTemplatesMtx;
+    std::vector<std::pair<std::string, std::string>> pendingTemplates;
 
     void handleMessages(int id);
 
+    /**
+     * Enqueue template (one attempt)
+     * @return error of librdkafka
+     */
+    rd_kafka_resp_err_t produceTemplate(const std::string &key,
+                                        const std::string &value);
+
+    /**
+     * Keep template for the next attempt of the poll thread
+     */
+    void deferTemplate(std::string key, std::string value);
+
+    /**
+     * Send again templates which were not enqueued or delivered
+     */
+    void resendTemplates();
+
+    /**
+     * Serve delivery reports until the producer is disconnected
+     */
+    void poll();
+
     // callback function / message delivery
     static void dr_msg_cb(rd_kafka_t *rk, const rd_kafka_message_t
     *rkmessage, void *opaque);
@@ -44,12 +91,16 @@ public:
      *
      * @param[in] ip apache kafka
      * @param[in] port apache kafka
-     * @param[in] topicList topic message
-     * @param[in] canLog can log data
-     * @param[in] logFilePath path to log file
+     * @param[in] topicNames topics of messages by index (default first)
+     * @param[in] templateTopic topic of templates (compact records)
+     * @param[in] properties properties of librdkafka (name, value)
+     * @param[in] bufferPool pool of output buffers
      */
     KafkaProducer(std::string ip, std::string port,
-                  std::string topicList);
+                  std::vector<std::string> topicNames,
+                  std::string templateTopic,
+                  std::vector<std::pair<std::string, std::string>> properties,
+                  std::shared_ptr<BufferPool> bufferPool);
 
     /**
      * \brief Copy constructor
@@ -67,14 +118,40 @@ public:
 /**
  * \brief Send message by kafka producer
  *
- * @param[in] message message buffer
- * @param[in] len message buffer length
- * @return state if message sucessful delivered
+ * Ownership of the buffer is handed over to librdkafka without copying, the
+ * buffer returns to the pool from the delivery report (or immediately on
+ * failure). Thread-safe, may be called by all conversion threads
+ * concurrently.
+ * @param[in] buffer message buffer taken from the pool
+ * @return state if message sucessful enqueued
+ */
+    bool sendMessage(OutputBuffer *buffer);
+
+/**
+ * \brief Send template of compact records to the topic of templates
+ *
+ * The message is keyed, so the topic may be compacted. Key and value are
+ * copied. Waits while the queue of librdkafka is full. Templates which are
+ * not enqueued or not delivered are sent again by the poll thread, until
+ * they are delivered. Thread-safe.
+ * @param[in] key key of the template
+ * @param[in] value description of the template (JSON)
+ * @return state if message sucessful enqueued (false - sent again later)
  */
-    bool sendMessage(const char *message, uint32_t len);
+    bool sendTemplate(const std::string &key, const std::string &value);
 
 /**
  * \brief Flush final message and destroy producent instance
  */
     void disconnect();
+
+/**
+ * \brief Log delivery statistics
+ */
+    void logStats();
+
+/**
+ * \brief Number of messages with delivery report (delivered or failed)
+ */
+    uint64_t getReportedMessages() const;
 };
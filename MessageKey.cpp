@@ -0,0 +1,178 @@
+#include "MessageKey.h"
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+namespace {
+
+//IANA IDs of 5-tuple
+constexpr uint16_t IE_PROTOCOL = 4;
+constexpr uint16_t IE_SRC_PORT = 7;
+constexpr uint16_t IE_SRC_IPV4 = 8;
+constexpr uint16_t IE_DST_PORT = 11;
+constexpr uint16_t IE_DST_IPV4 = 12;
+constexpr uint16_t IE_SRC_IPV6 = 27;
+constexpr uint16_t IE_DST_IPV6 = 28;
+
+//positions of 5-tuple in parts of the plan
+enum FlowPart {
+    FLOW_SRC_ADDR,
+    FLOW_DST_ADDR,
+    FLOW_SRC_PORT,
+    FLOW_DST_PORT,
+    FLOW_PROTOCOL,
+    FLOW_PARTS
+};
+
+//FNV-1a (64 bit)
+constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+uint64_t fnv1a(uint64_t hash, const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+void appendBigEndian(std::string &key, uint64_t value, size_t size) {
+    for (size_t i = size; i > 0; i--) {
+        key.push_back(char(value >> (8 * (i - 1))));
+    }
+}
+
+} // namespace
+
+MessageKey::MessageKey(std::shared_ptr<ConfigKafka> configKafka) {
+    type = configKafka->messageKey;
+    fields = configKafka->keyFields;
+}
+
+const fds_tfield *MessageKey::find(const fds_template *tmplt, uint16_t id) {
+    for (uint16_t i = 0; i < tmplt->fields_cnt_total; i++) {
+        if (tmplt->fields[i].en == 0 && tmplt->fields[i].id == id) {
+            return &tmplt->fields[i];
+        }
+    }
+    return nullptr;
+}
+
+std::unique_ptr<KeyPlan>
+MessageKey::compile(const SharedTemplate *shared) const {
+    const fds_template *tmplt = shared->tmplt;
+    std::unique_ptr<KeyPlan> plan = std::make_unique<KeyPlan>();
+    plan->dynamic = (tmplt->flags & FDS_TEMPLATE_DYNAMIC) != 0;
+
+    std::vector<const fds_tfield *> found;
+    if (type == KEY_FLOW) {
+        //IPv4 addresses, or IPv6 if the template has no IPv4 source
+        const bool ipv4 = find(tmplt, IE_SRC_IPV4) != nullptr;
+        found.resize(FLOW_PARTS);
+        found[FLOW_SRC_ADDR] = find(tmplt, ipv4 ? IE_SRC_IPV4 : IE_SRC_IPV6);
+        found[FLOW_DST_ADDR] = find(tmplt, ipv4 ? IE_DST_IPV4 : IE_DST_IPV6);
+        found[FLOW_SRC_PORT] = find(tmplt, IE_SRC_PORT);
+        found[FLOW_DST_PORT] = find(tmplt, IE_DST_PORT);
+        found[FLOW_PROTOCOL] = find(tmplt, IE_PROTOCOL);
+    } else {
+        for (const std::string &name : fields) {
+            found.push_back(shared->find(name));
+        }
+    }
+
+    for (const fds_tfield *tfield : found) {
+        KeyPlan::Part part = {0, 0, 0, 0};
+        if (tfield != nullptr) {
+            part = {tfield->en, tfield->id, tfield->offset, tfield->length};
+        }
+        plan->parts.push_back(part);
+    }
+    return plan;
+}
+
+bool MessageKey::read(const KeyPlan *plan, const KeyPlan::Part &part,
+                      fds_drec *rec, fds_drec_field *field) {
+    if (part.id == 0) {
+        return false;
+    }
+    if (plan->dynamic) {
+        return fds_drec_find(rec, part.en, part.id, field) != FDS_EOC;
+    }
+    field->data = rec->data + part.offset;
+    field->size = part.length;
+    return true;
+}
+
+void MessageKey::flowHash(const KeyPlan *plan, fds_drec *rec,
+                          std::string &key) {
+    fds_drec_field src;
+    fds_drec_field dst;
+    if (!read(plan, plan->parts[FLOW_SRC_ADDR], rec, &src) ||
+        !read(plan, plan->parts[FLOW_DST_ADDR], rec, &dst) ||
+        src.size != dst.size) {
+        return;
+    }
+
+    //ports and protocol are optional (e.g. ICMP), reduced-size encoding
+    //of exporters does not change the hash
+    uint64_t srcPort = 0;
+    uint64_t dstPort = 0;
+    uint64_t protocol = 0;
+    fds_drec_field field;
+    if (read(plan, plan->parts[FLOW_SRC_PORT], rec, &field)) {
+        fds_get_uint_be(field.data, field.size, &srcPort);
+    }
+    if (read(plan, plan->parts[FLOW_DST_PORT], rec, &field)) {
+        fds_get_uint_be(field.data, field.size, &dstPort);
+    }
+    if (read(plan, plan->parts[FLOW_PROTOCOL], rec, &field)) {
+        fds_get_uint_be(field.data, field.size, &protocol);
+    }
+
+    //endpoints in canonical order, both directions have the same hash
+    int order = memcmp(src.data, dst.data, src.size);
+    if (order > 0 || (order == 0 && srcPort > dstPort)) {
+        std::swap(src, dst);
+        std::swap(srcPort, dstPort);
+    }
+
+    const uint8_t ports[5] = {uint8_t(srcPort >> 8), uint8_t(srcPort),
+                              uint8_t(dstPort >> 8), uint8_t(dstPort),
+                              uint8_t(protocol)};
+    uint64_t hash = FNV_OFFSET;
+    hash = fnv1a(hash, src.data, src.size);
+    hash = fnv1a(hash, dst.data, dst.size);
+    hash = fnv1a(hash, ports, sizeof(ports));
+    appendBigEndian(key, hash, sizeof(hash));
+}
+
+void MessageKey::build(const SharedTemplate *shared, fds_drec *rec,
+                       uint32_t odid, std::string &key) const {
+    key.clear();
+    if (type == KEY_NONE) {
+        return;
+    }
+    if (type == KEY_ODID) {
+        appendBigEndian(key, odid, sizeof(odid));
+        return;
+    }
+
+    std::call_once(shared->keyFlag, [this, shared] {
+        shared->keyPlan = compile(shared);
+    });
+    const KeyPlan *plan = static_cast<const KeyPlan *>(
+            shared->keyPlan.get());
+
+    if (type == KEY_FLOW) {
+        flowHash(plan, rec, key);
+        return;
+    }
+
+    //missing fields are left out
+    fds_drec_field field;
+    for (const KeyPlan::Part &part : plan->parts) {
+        if (read(plan, part, rec, &field)) {
+            key.append(reinterpret_cast<const char *>(field.data),
+                       field.size);
+        }
+    }
+}
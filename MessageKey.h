@@ -0,0 +1,109 @@
+#ifndef MESSAGE_KEY_H
+#define MESSAGE_KEY_H
+
+#include <ipfixcol2.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Config.h"
+#include "TemplateCache.h"
+
+/**
+ * \brief Fields of the key in one template
+ *
+ * Generated on the first record of the template, so the fields are not
+ * searched by name in each record.
+ */
+class KeyPlan final : public TemplatePlan {
+public:
+    /** Field of the key */
+    struct Part {
+        /** enterprise number of the field                                 */
+        uint32_t en;
+        /** ID of the field, 0 if the template does not contain it         */
+        uint16_t id;
+        /** offset of the field in record (static templates only)          */
+        uint16_t offset;
+        /** length of the field (static templates only)                    */
+        uint16_t length;
+    };
+
+    /** template has variable-length fields                                */
+    bool dynamic;
+    /** fields of the key (flow - addresses, ports and protocol)           */
+    std::vector<Part> parts;
+};
+
+/**
+ * \brief Key of kafka messages computed from raw records
+ *
+ * Keyed messages are placed to partitions by hash of the key, so records of
+ * one exporter or one flow are consumed together. Keys are binary:
+ * - ODID (4 bytes, big endian),
+ * - symmetric hash of 5-tuple (8 bytes, big endian), both directions of the
+ *   flow have the same key,
+ * - raw values of listed fields in the listed order.
+ * Records without the fields of the key are sent without key.
+ */
+class MessageKey final {
+private:
+    message_key type;
+    //listed fields ("scope:name", "name" of IANA or "enX:idY")
+    std::vector<std::string> fields;
+
+    /**
+     * Find fields of the key in the template
+     * @param[in] shared template
+     * @return fields of the key
+     */
+    std::unique_ptr<KeyPlan> compile(const SharedTemplate *shared) const;
+
+    /**
+     * Find the first field of the template with the IANA ID
+     * @param[in] tmplt template
+     * @param[in] id ID of the field
+     * @return field or nullptr
+     */
+    static const fds_tfield *find(const fds_template *tmplt, uint16_t id);
+
+    /**
+     * Value of the field in the record
+     * @param[in] plan fields of the key
+     * @param[in] part field of the key
+     * @param[in] rec record
+     * @param[out] field value
+     * @return false if the record does not contain the field
+     */
+    static bool read(const KeyPlan *plan, const KeyPlan::Part &part,
+                     fds_drec *rec, fds_drec_field *field);
+
+    /**
+     * Symmetric hash of 5-tuple
+     * @param[in] plan fields of the key
+     * @param[in] rec record
+     * @param[out] key key (empty if the record has no addresses)
+     */
+    static void flowHash(const KeyPlan *plan, fds_drec *rec,
+                         std::string &key);
+
+public:
+    /**
+     * \brief Constructor
+     * @param[in] configKafka configuration of kafka (type and fields of key)
+     */
+    explicit MessageKey(std::shared_ptr<ConfigKafka> configKafka);
+
+    /**
+     * \brief Compute key of the record
+     *
+     * @param[in] shared template of the record
+     * @param[in] rec record
+     * @param[in] odid observation domain ID of the record
+     * @param[out] key key of the message (empty - no key)
+     */
+    void build(const SharedTemplate *shared, fds_drec *rec, uint32_t odid,
+               std::string &key) const;
+};
+
+#endif // MESSAGE_KEY_H
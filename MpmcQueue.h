@@ -0,0 +1,137 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+//cells and the queue itself are over-aligned, below C++17 operator new
+//would silently ignore the alignment
+#ifndef __cpp_aligned_new
+#error "MpmcQueue requires C++17 aligned new"
+#endif
+
+/**
+ * \brief Lock-free bounded multi-producer multi-consumer queue
+ *
+ * Ring of cells with sequence numbers (D. Vyukov's bounded MPMC queue).
+ * Producers and consumers claim a position by CAS on their own counter and
+ * then hand the cell over by publishing its sequence number, so neither side
+ * takes a lock. Counters and cells are aligned to a cache line to avoid false
+ * sharing between threads.
+ *
+ * @tparam T movable value type
+ */
+template<typename T>
+class MpmcQueue final {
+private:
+    static constexpr size_t cacheLineSize = 64;
+
+    struct alignas(cacheLineSize) Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    const size_t size;
+    std::unique_ptr<Cell[]> cells;
+
+    alignas(cacheLineSize) std::atomic<size_t> enqueuePos;
+    alignas(cacheLineSize) std::atomic<size_t> dequeuePos;
+
+public:
+    /**
+     * \brief Constructor
+     * @param[in] capacity maximal number of values in queue
+     */
+    explicit MpmcQueue(size_t capacity) : size(capacity),
+                                          cells(new Cell[capacity]) {
+        for (size_t i = 0; i < size; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos.store(0, std::memory_order_relaxed);
+        dequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue &) = delete;
+
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+    /**
+     * \brief Add value to queue
+     * @param[in,out] value value, moved out only on success
+     * @return false if queue is full
+     */
+    bool tryPush(T &value) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;) {
+            cell = &cells[pos % size];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                //full
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * \brief Take value from queue
+     * @param[out] value taken value
+     * @return false if queue is empty
+     */
+    bool tryPop(T &value) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;) {
+            cell = &cells[pos % size];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                //empty
+                return false;
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(cell->data);
+        cell->sequence.store(pos + size, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * \brief Check if queue seems empty (approximate under concurrency)
+     */
+    bool empty() const {
+        return enqueuePos.load(std::memory_order_relaxed) ==
+               dequeuePos.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Maximal number of values in queue
+     */
+    size_t capacity() const {
+        return size;
+    }
+};
+
+#endif // MPMC_QUEUE_H
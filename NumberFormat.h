@@ -0,0 +1,190 @@
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#ifdef HAVE_FLOAT_TO_CHARS
+#include <charconv>
+#else
+#include <libfds.h>
+#endif
+
+/**
+ * \brief Formatting of numeric IPFIX fields for JSON output
+ *
+ * Integers are read from network byte order (including reduced-size
+ * encoding) and written by pairs of digits. Output is identical to the
+ * libfds converters (fds_uint2str_be, fds_int2str_be, fds_float2str_be).
+ */
+namespace NumberFormat {
+
+/** digits of numbers 00 - 99 */
+constexpr char digitPairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233"
+        "34353637383940414243444546474849505152535455565758596061626364656667"
+        "6869707172737475767778798081828384858687888990919293949596979899";
+
+/** maximal length of formatted 64-bit integer (with sign)                 */
+constexpr size_t MAX_INT_LENGTH = 20;
+
+/**
+ * \brief Read unsigned integer in network byte order
+ * @param[in] data field data
+ * @param[in] size field size (1 - 8)
+ * @return value
+ */
+inline uint64_t readUintBe(const uint8_t *data, size_t size) {
+    switch (size) {
+        case 1:
+            return data[0];
+        case 2: {
+            uint16_t value;
+            memcpy(&value, data, 2);
+            return __builtin_bswap16(value);
+        }
+        case 4: {
+            uint32_t value;
+            memcpy(&value, data, 4);
+            return __builtin_bswap32(value);
+        }
+        case 8: {
+            uint64_t value;
+            memcpy(&value, data, 8);
+            return __builtin_bswap64(value);
+        }
+        default: {
+            //reduced-size encoding
+            uint64_t value = 0;
+            for (size_t i = 0; i < size; i++) {
+                value = value << 8 | data[i];
+            }
+            return value;
+        }
+    }
+}
+
+/**
+ * \brief Read signed integer in network byte order
+ * @param[in] data field data
+ * @param[in] size field size (1 - 8)
+ * @return value
+ */
+inline int64_t readIntBe(const uint8_t *data, size_t size) {
+    const uint32_t shift = 64 - 8 * size;
+    return int64_t(readUintBe(data, size) << shift) >> shift;
+}
+
+/**
+ * \brief Number of decimal digits
+ */
+inline uint32_t countDigits(uint64_t value) {
+    uint32_t digits = 1;
+    for (;;) {
+        if (value < 10) {
+            return digits;
+        }
+        if (value < 100) {
+            return digits + 1;
+        }
+        if (value < 1000) {
+            return digits + 2;
+        }
+        if (value < 10000) {
+            return digits + 3;
+        }
+        value /= 10000;
+        digits += 4;
+    }
+}
+
+/**
+ * \brief Write unsigned integer
+ * @param[in] value value
+ * @param[out] out output (at least MAX_INT_LENGTH chars)
+ * @return end of written chars
+ */
+inline char *writeUint(uint64_t value, char *out) {
+    char *end = out + countDigits(value);
+    char *pos = end;
+    while (value >= 100) {
+        const uint64_t pair = value % 100;
+        value /= 100;
+        pos -= 2;
+        memcpy(pos, digitPairs + pair * 2, 2);
+    }
+    if (value >= 10) {
+        memcpy(pos - 2, digitPairs + value * 2, 2);
+    } else {
+        pos[-1] = char('0' + value);
+    }
+    return end;
+}
+
+/**
+ * \brief Write signed integer
+ * @param[in] value value
+ * @param[out] out output (at least MAX_INT_LENGTH chars)
+ * @return end of written chars
+ */
+inline char *writeInt(int64_t value, char *out) {
+    uint64_t magnitude = value;
+    if (value < 0) {
+        *out++ = '-';
+        magnitude = 0 - magnitude;
+    }
+    return writeUint(magnitude, out);
+}
+
+/**
+ * \brief Write float field
+ *
+ * Same digits as printf("%.*g") with FLT_DIG / DBL_DIG precision used by
+ * fds_float2str_be. Without floating-point std::to_chars (checked by CMake,
+ * HAVE_FLOAT_TO_CHARS), fds_float2str_be itself is used.
+ * @param[in] data field data
+ * @param[in] size field size (4 or 8)
+ * @param[out] out output
+ * @param[in] outSize size of output
+ * @return number of written chars, negative if the value is not finite or
+ * does not fit
+ */
+inline int writeFloatBe(const uint8_t *data, size_t size, char *out,
+                        size_t outSize) {
+    double value;
+    int precision;
+    if (size == 4) {
+        const uint32_t bits = readUintBe(data, 4);
+        float single;
+        memcpy(&single, &bits, 4);
+        value = single;
+        precision = FLT_DIG;
+    } else if (size == 8) {
+        const uint64_t bits = readUintBe(data, 8);
+        memcpy(&value, &bits, 8);
+        precision = DBL_DIG;
+    } else {
+        return -1;
+    }
+    if (!__builtin_isfinite(value)) {
+        return -1;
+    }
+#ifdef HAVE_FLOAT_TO_CHARS
+    const std::to_chars_result result = std::to_chars(
+            out, out + outSize, value, std::chars_format::general,
+            precision);
+    if (result.ec != std::errc()) {
+        return -1;
+    }
+    return result.ptr - out;
+#else
+    (void) precision;
+    const int rc = fds_float2str_be(data, size, out, outSize);
+    return rc < 0 ? -1 : rc;
+#endif
+}
+
+} // namespace NumberFormat
+
+#endif // NUMBER_FORMAT_H
@@ -0,0 +1,456 @@
+#include "PackedConverter.h"
+#include "NumberFormat.h"
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+//maximal length of encoded header of value (type and length / value)
+constexpr size_t MAX_HEADER_LENGTH = 9;
+
+//big-endian bytes
+template<typename T>
+inline uint8_t *writeBigEndian(T value, uint8_t *out) {
+    for (size_t i = sizeof(T); i > 0; i--) {
+        *out++ = uint8_t(uint64_t(value) >> (8 * (i - 1)));
+    }
+    return out;
+}
+
+/** MessagePack primitives */
+struct MsgPackWriter {
+    static uint8_t *map(size_t count, uint8_t *out) {
+        if (count < 16) {
+            *out++ = uint8_t(0x80 | count);
+            return out;
+        }
+        if (count <= 0xFFFF) {
+            *out++ = 0xDE;
+            return writeBigEndian(uint16_t(count), out);
+        }
+        *out++ = 0xDF;
+        return writeBigEndian(uint32_t(count), out);
+    }
+
+    static uint8_t *array(size_t count, uint8_t *out) {
+        if (count < 16) {
+            *out++ = uint8_t(0x90 | count);
+            return out;
+        }
+        if (count <= 0xFFFF) {
+            *out++ = 0xDC;
+            return writeBigEndian(uint16_t(count), out);
+        }
+        *out++ = 0xDD;
+        return writeBigEndian(uint32_t(count), out);
+    }
+
+    static uint8_t *uint(uint64_t value, uint8_t *out) {
+        if (value < 0x80) {
+            *out++ = uint8_t(value);
+            return out;
+        }
+        if (value <= 0xFF) {
+            *out++ = 0xCC;
+            *out++ = uint8_t(value);
+            return out;
+        }
+        if (value <= 0xFFFF) {
+            *out++ = 0xCD;
+            return writeBigEndian(uint16_t(value), out);
+        }
+        if (value <= 0xFFFFFFFF) {
+            *out++ = 0xCE;
+            return writeBigEndian(uint32_t(value), out);
+        }
+        *out++ = 0xCF;
+        return writeBigEndian(value, out);
+    }
+
+    static uint8_t *sint(int64_t value, uint8_t *out) {
+        if (value >= 0) {
+            return uint(value, out);
+        }
+        if (value >= -32) {
+            *out++ = uint8_t(value);
+            return out;
+        }
+        if (value >= INT8_MIN) {
+            *out++ = 0xD0;
+            *out++ = uint8_t(value);
+            return out;
+        }
+        if (value >= INT16_MIN) {
+            *out++ = 0xD1;
+            return writeBigEndian(uint16_t(value), out);
+        }
+        if (value >= INT32_MIN) {
+            *out++ = 0xD2;
+            return writeBigEndian(uint32_t(value), out);
+        }
+        *out++ = 0xD3;
+        return writeBigEndian(uint64_t(value), out);
+    }
+
+    static uint8_t *float32(uint32_t bits, uint8_t *out) {
+        *out++ = 0xCA;
+        return writeBigEndian(bits, out);
+    }
+
+    static uint8_t *float64(uint64_t bits, uint8_t *out) {
+        *out++ = 0xCB;
+        return writeBigEndian(bits, out);
+    }
+
+    static uint8_t *boolean(bool value, uint8_t *out) {
+        *out++ = value ? 0xC3 : 0xC2;
+        return out;
+    }
+
+    static uint8_t *binary(const uint8_t *data, size_t size, uint8_t *out) {
+        if (size <= 0xFF) {
+            *out++ = 0xC4;
+            *out++ = uint8_t(size);
+        } else if (size <= 0xFFFF) {
+            *out++ = 0xC5;
+            out = writeBigEndian(uint16_t(size), out);
+        } else {
+            *out++ = 0xC6;
+            out = writeBigEndian(uint32_t(size), out);
+        }
+        memcpy(out, data, size);
+        return out + size;
+    }
+
+    static uint8_t *string(const uint8_t *data, size_t size, uint8_t *out) {
+        if (size < 32) {
+            *out++ = uint8_t(0xA0 | size);
+        } else if (size <= 0xFF) {
+            *out++ = 0xD9;
+            *out++ = uint8_t(size);
+        } else if (size <= 0xFFFF) {
+            *out++ = 0xDA;
+            out = writeBigEndian(uint16_t(size), out);
+        } else {
+            *out++ = 0xDB;
+            out = writeBigEndian(uint32_t(size), out);
+        }
+        memcpy(out, data, size);
+        return out + size;
+    }
+};
+
+/** CBOR primitives (RFC 8949) */
+struct CborWriter {
+    static uint8_t *head(uint8_t major, uint64_t value, uint8_t *out) {
+        major <<= 5;
+        if (value < 24) {
+            *out++ = uint8_t(major | value);
+            return out;
+        }
+        if (value <= 0xFF) {
+            *out++ = major | 24;
+            *out++ = uint8_t(value);
+            return out;
+        }
+        if (value <= 0xFFFF) {
+            *out++ = major | 25;
+            return writeBigEndian(uint16_t(value), out);
+        }
+        if (value <= 0xFFFFFFFF) {
+            *out++ = major | 26;
+            return writeBigEndian(uint32_t(value), out);
+        }
+        *out++ = major | 27;
+        return writeBigEndian(value, out);
+    }
+
+    static uint8_t *map(size_t count, uint8_t *out) {
+        return head(5, count, out);
+    }
+
+    static uint8_t *array(size_t count, uint8_t *out) {
+        return head(4, count, out);
+    }
+
+    static uint8_t *uint(uint64_t value, uint8_t *out) {
+        return head(0, value, out);
+    }
+
+    static uint8_t *sint(int64_t value, uint8_t *out) {
+        if (value >= 0) {
+            return head(0, value, out);
+        }
+        //negative integer is encoded as -1 - value
+        return head(1, ~uint64_t(value), out);
+    }
+
+    static uint8_t *float32(uint32_t bits, uint8_t *out) {
+        *out++ = 0xFA;
+        return writeBigEndian(bits, out);
+    }
+
+    static uint8_t *float64(uint64_t bits, uint8_t *out) {
+        *out++ = 0xFB;
+        return writeBigEndian(bits, out);
+    }
+
+    static uint8_t *boolean(bool value, uint8_t *out) {
+        *out++ = value ? 0xF5 : 0xF4;
+        return out;
+    }
+
+    static uint8_t *binary(const uint8_t *data, size_t size, uint8_t *out) {
+        out = head(2, size, out);
+        memcpy(out, data, size);
+        return out + size;
+    }
+
+    static uint8_t *string(const uint8_t *data, size_t size, uint8_t *out) {
+        out = head(3, size, out);
+        memcpy(out, data, size);
+        return out + size;
+    }
+};
+
+//append encoded string to the plan
+template<typename Writer>
+void appendString(std::string &out, const std::string &text) {
+    std::vector<uint8_t> encoded(MAX_HEADER_LENGTH + text.size());
+    const uint8_t *end = Writer::string(
+            reinterpret_cast<const uint8_t *>(text.data()), text.size(),
+            encoded.data());
+    out.append(reinterpret_cast<const char *>(encoded.data()),
+               end - encoded.data());
+}
+
+/**
+ * Encode value of the field
+ * @return end of written bytes or nullptr on malformed value
+ */
+template<typename Writer>
+uint8_t *encodeValue(const PackedPlan::Field &field, const uint8_t *data,
+                     uint16_t size, uint8_t *out) {
+    switch (field.type) {
+        case PackedPlan::Type::UINT:
+            if (size < 1 || size > 8) {
+                return nullptr;
+            }
+            return Writer::uint(NumberFormat::readUintBe(data, size), out);
+        case PackedPlan::Type::INT:
+            if (size < 1 || size > 8) {
+                return nullptr;
+            }
+            return Writer::sint(NumberFormat::readIntBe(data, size), out);
+        case PackedPlan::Type::FLOAT32:
+            if (size != 4) {
+                return nullptr;
+            }
+            return Writer::float32(uint32_t(NumberFormat::readUintBe(data, 4)),
+                                   out);
+        case PackedPlan::Type::FLOAT64: {
+            double value;
+            if (fds_get_float_be(data, size, &value) != FDS_OK) {
+                return nullptr;
+            }
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return Writer::float64(bits, out);
+        }
+        case PackedPlan::Type::BOOL:
+            if (size != 1) {
+                return nullptr;
+            }
+            //IPFIX true is 1, false is 2
+            return Writer::boolean(data[0] == 1, out);
+        case PackedPlan::Type::TIMESTAMP: {
+            uint64_t value;
+            if (fds_get_datetime_lp_be(data, size, field.dataType, &value) !=
+                FDS_OK) {
+                return nullptr;
+            }
+            return Writer::uint(value, out);
+        }
+        case PackedPlan::Type::BINARY:
+            return Writer::binary(data, size, out);
+        case PackedPlan::Type::STRING:
+            return Writer::string(data, size, out);
+    }
+    return nullptr;
+}
+
+} // namespace
+
+PackedConverter::PackedConverter(std::shared_ptr<ConfigFormat> configFormat,
+                                 bool cbor)
+        : RecordConverter(configFormat) {
+    this->cbor = cbor;
+}
+
+template<typename Writer>
+std::unique_ptr<PackedPlan>
+PackedConverter::compile(const fds_template *tmplt) const {
+    std::unique_ptr<PackedPlan> plan = std::make_unique<PackedPlan>();
+    plan->dynamic = (tmplt->flags & FDS_TEMPLATE_DYNAMIC) != 0;
+
+    for (uint16_t i = 0; i < tmplt->fields_cnt_total; i++) {
+        const fds_tfield &tfield = tmplt->fields[i];
+        const fds_iemgr_elem *def = tfield.def;
+        if (tfield.en == 0 && tfield.id == 210) {
+            //paddingOctets
+            continue;
+        }
+        if (def == nullptr && configFormat->ignore_unknown) {
+            continue;
+        }
+        if (!isSelected(tfield)) {
+            continue;
+        }
+
+        PackedPlan::Field field;
+        field.index = i;
+        field.offset = tfield.offset;
+        field.length = tfield.length;
+        field.dataType = def ? def->data_type : FDS_ET_OCTET_ARRAY;
+        switch (field.dataType) {
+            case FDS_ET_UNSIGNED_8:
+            case FDS_ET_UNSIGNED_16:
+            case FDS_ET_UNSIGNED_32:
+            case FDS_ET_UNSIGNED_64:
+                field.type = PackedPlan::Type::UINT;
+                break;
+            case FDS_ET_SIGNED_8:
+            case FDS_ET_SIGNED_16:
+            case FDS_ET_SIGNED_32:
+            case FDS_ET_SIGNED_64:
+                field.type = PackedPlan::Type::INT;
+                break;
+            case FDS_ET_FLOAT_32:
+                field.type = PackedPlan::Type::FLOAT32;
+                break;
+            case FDS_ET_FLOAT_64:
+                field.type = PackedPlan::Type::FLOAT64;
+                break;
+            case FDS_ET_BOOLEAN:
+                field.type = PackedPlan::Type::BOOL;
+                break;
+            case FDS_ET_DATE_TIME_SECONDS:
+            case FDS_ET_DATE_TIME_MILLISECONDS:
+            case FDS_ET_DATE_TIME_MICROSECONDS:
+            case FDS_ET_DATE_TIME_NANOSECONDS:
+                field.type = PackedPlan::Type::TIMESTAMP;
+                break;
+            case FDS_ET_STRING:
+                field.type = PackedPlan::Type::STRING;
+                break;
+            case FDS_ET_OCTET_ARRAY:
+            case FDS_ET_MAC_ADDRESS:
+            case FDS_ET_IPV4_ADDRESS:
+            case FDS_ET_IPV6_ADDRESS:
+                field.type = PackedPlan::Type::BINARY;
+                break;
+            default:
+                //lists and unassigned types are not encoded
+                continue;
+        }
+
+        std::string name;
+        if (def == nullptr || configFormat->numeric_names) {
+            name = "en" + std::to_string(tfield.en) + ":id" +
+                   std::to_string(tfield.id);
+        } else {
+            name = std::string(def->scope->name) + ":" + def->name;
+        }
+        std::string key;
+        appendString<Writer>(key, name);
+
+        //repeated Information Elements share one member
+        bool found = false;
+        for (PackedPlan::Entry &entry : plan->entries) {
+            if (entry.key == key) {
+                entry.fields.push_back(field);
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            plan->entries.push_back({key, {field}});
+        }
+    }
+
+    uint8_t map[MAX_HEADER_LENGTH];
+    plan->header.assign(reinterpret_cast<const char *>(map),
+                        Writer::map(plan->entries.size() + 1, map) - map);
+    appendString<Writer>(plan->header, "@type");
+    appendString<Writer>(plan->header, "ipfix.entry");
+
+    plan->overhead = plan->header.size();
+    for (const PackedPlan::Entry &entry : plan->entries) {
+        plan->overhead += entry.key.size() + MAX_HEADER_LENGTH *
+                                             (entry.fields.size() + 1);
+    }
+    return plan;
+}
+
+template<typename Writer>
+int PackedConverter::encode(const PackedPlan *plan, fds_drec *rec,
+                            OutputBuffer *buffer,
+                            ConverterState *state) const {
+    if (plan->dynamic) {
+        collectFields(rec, state);
+    }
+    if (!buffer->reserve(plan->overhead + rec->size)) {
+        return FDS_ERR_NOMEM;
+    }
+
+    uint8_t *begin = reinterpret_cast<uint8_t *>(buffer->data +
+                                                 buffer->length);
+    uint8_t *out = begin;
+    memcpy(out, plan->header.data(), plan->header.size());
+    out += plan->header.size();
+
+    for (const PackedPlan::Entry &entry : plan->entries) {
+        memcpy(out, entry.key.data(), entry.key.size());
+        out += entry.key.size();
+        if (entry.fields.size() > 1) {
+            out = Writer::array(entry.fields.size(), out);
+        }
+        for (const PackedPlan::Field &field : entry.fields) {
+            const uint8_t *data;
+            uint16_t size;
+            if (plan->dynamic) {
+                data = state->fields[field.index].data;
+                size = state->fields[field.index].size;
+            } else {
+                data = rec->data + field.offset;
+                size = field.length;
+            }
+            out = encodeValue<Writer>(field, data, size, out);
+            if (out == nullptr) {
+                return FDS_ERR_FORMAT;
+            }
+        }
+    }
+
+    buffer->length += out - begin;
+    return out - begin;
+}
+
+int PackedConverter::convert(const SharedTemplate *shared, fds_drec *rec,
+                             const fds_iemgr_t *iemgr, OutputBuffer *buffer,
+                             ConverterState *state) const {
+    (void) iemgr;
+    std::call_once(shared->planFlag, [this, shared]() {
+        if (cbor) {
+            shared->plan = compile<CborWriter>(shared->tmplt);
+        } else {
+            shared->plan = compile<MsgPackWriter>(shared->tmplt);
+        }
+    });
+    const PackedPlan *plan =
+            static_cast<const PackedPlan *>(shared->plan.get());
+    if (cbor) {
+        return encode<CborWriter>(plan, rec, buffer, state);
+    }
+    return encode<MsgPackWriter>(plan, rec, buffer, state);
+}
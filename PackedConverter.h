@@ -0,0 +1,106 @@
+#ifndef PACKED_CONVERTER_H
+#define PACKED_CONVERTER_H
+
+#include <ipfixcol2.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "RecordConverter.h"
+
+/**
+ * \brief Encoding plan of one template for MessagePack / CBOR
+ *
+ * Map header and keys are encoded when the plan is compiled, values are
+ * encoded per record.
+ */
+class PackedPlan final : public TemplatePlan {
+public:
+    /** Encoding of field value */
+    enum class Type : uint8_t {
+        UINT,      /**< unsigned integer (also TCP flags and protocol)     */
+        INT,       /**< signed integer                                     */
+        FLOAT32,   /**< single precision float                             */
+        FLOAT64,   /**< double precision float                             */
+        BOOL,      /**< boolean                                            */
+        TIMESTAMP, /**< unix timestamp in milliseconds (integer)           */
+        BINARY,    /**< raw field data (addresses, octet arrays)           */
+        STRING     /**< string                                             */
+    };
+
+    /** Encoded field */
+    struct Field {
+        /** index of the field in template                                 */
+        uint16_t index;
+        /** offset of the field in record (static templates only)          */
+        uint16_t offset;
+        /** length of the field (static templates only)                    */
+        uint16_t length;
+        /** encoding                                                       */
+        Type type;
+        /** data type of the field                                         */
+        fds_iemgr_element_type dataType;
+    };
+
+    /** Member of the map, repeated Information Elements form an array */
+    struct Entry {
+        /** encoded key                                                    */
+        std::string key;
+        /** fields with the key in template order                          */
+        std::vector<Field> fields;
+    };
+
+    /** template has variable-length fields                                */
+    bool dynamic;
+    /** encoded map header and "@type" member                              */
+    std::string header;
+    /** members of the map                                                 */
+    std::vector<Entry> entries;
+    /** upper bound of encoded record without field data                   */
+    size_t overhead;
+};
+
+/**
+ * \brief Converter of IPFIX records to MessagePack or CBOR
+ *
+ * Records keep the structure of fds_drec2json output (map with "@type" and
+ * one member per Information Element, repeated elements as arrays), but
+ * values are native: integers, floats, booleans, binary addresses and
+ * integer timestamps (milliseconds). Fields with lists are not encoded.
+ */
+class PackedConverter final : public RecordConverter {
+private:
+    //CBOR, otherwise MessagePack
+    bool cbor;
+
+    /**
+     * Compile plan of the template
+     * @param[in] tmplt template
+     * @return plan
+     */
+    template<typename Writer>
+    std::unique_ptr<PackedPlan> compile(const fds_template *tmplt) const;
+
+    /**
+     * Encode record by the plan
+     * @return number of appended bytes or negative error code
+     */
+    template<typename Writer>
+    int encode(const PackedPlan *plan, fds_drec *rec, OutputBuffer *buffer,
+               ConverterState *state) const;
+
+public:
+    /**
+     * \brief Constructor
+     *
+     * @param[in] configFormat configuration of the output format
+     * @param[in] cbor encode CBOR, otherwise MessagePack
+     */
+    PackedConverter(std::shared_ptr<ConfigFormat> configFormat, bool cbor);
+
+    int convert(const SharedTemplate *shared, fds_drec *rec,
+                const fds_iemgr_t *iemgr, OutputBuffer *buffer,
+                ConverterState *state) const override;
+};
+
+#endif // PACKED_CONVERTER_H
@@ -0,0 +1,32 @@
+#include "RecordConverter.h"
+
+RecordConverter::RecordConverter(std::shared_ptr<ConfigFormat> configFormat) {
+    this->configFormat = configFormat;
+}
+
+bool RecordConverter::isSelected(const fds_tfield &tfield) const {
+    if (configFormat->projection == FIELDS_ALL) {
+        return true;
+    }
+
+    const std::unordered_set<std::string> &fields = configFormat->fields;
+    bool listed = fields.count("en" + std::to_string(tfield.en) + ":id" +
+                               std::to_string(tfield.id)) > 0;
+    const fds_iemgr_elem *def = tfield.def;
+    if (!listed && def != nullptr) {
+        listed = fields.count(std::string(def->scope->name) + ":" +
+                              def->name) > 0 ||
+                 (def->scope->pen == 0 && fields.count(def->name) > 0);
+    }
+    return listed == (configFormat->projection == FIELDS_ONLY);
+}
+
+void RecordConverter::collectFields(fds_drec *rec, ConverterState *state) {
+    //offsets differ in each record
+    state->fields.resize(rec->tmplt->fields_cnt_total);
+    fds_drec_iter iter;
+    fds_drec_iter_init(&iter, rec, FDS_DREC_PADDING_SHOW);
+    while (fds_drec_iter_next(&iter) != FDS_EOC) {
+        state->fields[iter.field.info - rec->tmplt->fields] = iter.field;
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef RECORD_CONVERTER_H
+#define RECORD_CONVERTER_H
+
+#include <ipfixcol2.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "BufferPool.h"
+#include "Config.h"
+#include "TemplateCache.h"
+#include "TimestampCache.h"
+
+/**
+ * \brief Records of one template buffered by the converter (e.g. Arrow batch)
+ */
+class PendingBatch {
+public:
+    /** index of topic of the batch (the topic of its first record)        */
+    uint16_t topic = 0;
+
+    virtual ~PendingBatch() = default;
+};
+
+/**
+ * \brief Per-thread state of the converter
+ */
+struct ConverterState {
+    /** fields of the record in template order (dynamic templates)         */
+    std::vector<fds_drec_field> fields;
+    /** output of fds_drec2json for cross-check                            */
+    std::vector<char> check;
+    /** formatted timestamps of recent seconds                             */
+    TimestampCache timestamps;
+    /** records buffered by the converter, by plan of their template       */
+    std::unordered_map<const TemplatePlan *,
+            std::unique_ptr<PendingBatch>> batches;
+    /** records of compiled plans converted by fds_drec2json, because a value
+     *  is not covered by the plan                                         */
+    uint64_t valueFallbacks = 0;
+};
+
+/**
+ * \brief Converter of IPFIX records to the output format of kafka messages
+ *
+ * One instance is shared by all conversion threads, per-template data are
+ * compiled on the first record and kept in the shared template.
+ */
+class RecordConverter {
+protected:
+    std::shared_ptr<ConfigFormat> configFormat;
+
+    /**
+     * Check if the field is emitted by projection of fields (\<fields>)
+     */
+    bool isSelected(const fds_tfield &tfield) const;
+
+    /**
+     * Fill fields of the record in template order (variable-length fields)
+     */
+    static void collectFields(fds_drec *rec, ConverterState *state);
+
+public:
+    /**
+     * \brief Constructor
+     * @param[in] configFormat configuration of the output format
+     */
+    explicit RecordConverter(std::shared_ptr<ConfigFormat> configFormat);
+
+    virtual ~RecordConverter() = default;
+
+    /**
+     * \brief Convert record and append it to buffer
+     *
+     * @param[in] shared template of the record
+     * @param[in] rec record for conversion
+     * @param[in] iemgr Information element manager
+     * @param[in,out] buffer output buffer (may grow)
+     * @param[in,out] state state of the calling thread
+     * @return number of appended bytes or negative error code
+     */
+    virtual int convert(const SharedTemplate *shared, fds_drec *rec,
+                        const fds_iemgr_t *iemgr, OutputBuffer *buffer,
+                        ConverterState *state) const = 0;
+
+    /**
+     * \brief Append one pending batch of records to buffer
+     *
+     * Only converters that buffer records themselves keep pending batches,
+     * each batch is one kafka message.
+     * @param[in,out] buffer output buffer (may grow)
+     * @param[in,out] state state of the calling thread
+     * @param[in] all drain batches regardless of their time limit
+     * @return number of appended bytes, 0 if there is no batch to drain or
+     * negative error code
+     */
+    virtual int drain(OutputBuffer *buffer, ConverterState *state,
+                      bool all) const {
+        (void) buffer;
+        (void) state;
+        (void) all;
+        return 0;
+    }
+};
+
+#endif // RECORD_CONVERTER_H
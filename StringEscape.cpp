@@ -0,0 +1,99 @@
+#include "StringEscape.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STRING_ESCAPE_X86
+#endif
+
+namespace {
+
+inline bool needsEscape(uint8_t c) {
+    return c < 0x20 || c >= 0x7F || c == '"' || c == '\\' || c == '/';
+}
+
+size_t findScalar(const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (needsEscape(data[i])) {
+            return i;
+        }
+    }
+    return size;
+}
+
+#ifdef STRING_ESCAPE_X86
+
+__attribute__((target("sse4.2")))
+size_t findSse42(const uint8_t *data, size_t size) {
+    //ranges of bytes which need escaping (pairs of inclusive bounds)
+    const __m128i ranges = _mm_setr_epi8(
+            0x00, 0x1F, '"', '"', '/', '/', '\\', '\\',
+            0x7F, (char) 0xFF, 0, 0, 0, 0, 0, 0);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(data + i));
+        const int index = _mm_cmpestri(
+                ranges, 10, chunk, 16,
+                _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES |
+                _SIDD_LEAST_SIGNIFICANT);
+        if (index < 16) {
+            return i + index;
+        }
+    }
+    return i + findScalar(data + i, size - i);
+}
+
+__attribute__((target("avx2")))
+size_t findAvx2(const uint8_t *data, size_t size) {
+    //short strings do not touch upper halves of registers at all
+    if (size < 32) {
+        return findSse42(data, size);
+    }
+    //signed compare with 0x20 covers control chars and non-ASCII bytes
+    const __m256i space = _mm256_set1_epi8(0x20);
+    const __m256i del = _mm256_set1_epi8(0x7F);
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i slash = _mm256_set1_epi8('/');
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(data + i));
+        __m256i match = _mm256_cmpgt_epi8(space, chunk);
+        match = _mm256_or_si256(match, _mm256_cmpeq_epi8(chunk, del));
+        match = _mm256_or_si256(match, _mm256_cmpeq_epi8(chunk, quote));
+        match = _mm256_or_si256(match, _mm256_cmpeq_epi8(chunk, backslash));
+        match = _mm256_or_si256(match, _mm256_cmpeq_epi8(chunk, slash));
+        const uint32_t mask = _mm256_movemask_epi8(match);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    //tails, legacy SSE code after AVX code with dirty upper halves of
+    //registers pays for transitions of their state (tens of cycles)
+    _mm256_zeroupper();
+    return i + findSse42(data + i, size - i);
+}
+
+#endif // STRING_ESCAPE_X86
+
+} // namespace
+
+const char *StringEscape::name = "scalar";
+
+const StringEscape::Kernel StringEscape::kernel = StringEscape::select();
+
+StringEscape::Kernel StringEscape::select() {
+#ifdef STRING_ESCAPE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        name = "avx2";
+        return findAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        name = "sse4.2";
+        return findSse42;
+    }
+#endif
+    return findScalar;
+}
@@ -0,0 +1,70 @@
+#ifndef STRING_ESCAPE_H
+#define STRING_ESCAPE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief Scanner of string fields for JSON output
+ *
+ * Finds bytes a JSON string cannot hold as they are: quotation mark,
+ * reverse solidus, solidus (escaped by libfds), control characters and
+ * non-ASCII bytes. The kernel (AVX2, SSE4.2 or scalar) is selected by the
+ * CPU when the plugin is loaded, so clean runs of strings are scanned 32 or
+ * 16 bytes at a time and copied in bulk.
+ */
+class StringEscape final {
+public:
+    /**
+     * \brief Find first byte which needs escaping
+     *
+     * @param[in] data string
+     * @param[in] size length of string
+     * @return index of the byte or size if the string is clean
+     */
+    static size_t find(const uint8_t *data, size_t size) {
+        return kernel(data, size);
+    }
+
+    /**
+     * \brief Short escape sequence of the byte
+     *
+     * @param[in] byte byte found by find()
+     * @return char after reverse solidus or 0 if the byte is left to
+     * fds_drec2json (control characters and non-ASCII bytes)
+     */
+    static char shortEscape(uint8_t byte) {
+        switch (byte) {
+            case '"':
+                return '"';
+            case '\\':
+                return '\\';
+            case '/':
+                return '/';
+            default:
+                return 0;
+        }
+    }
+
+    /**
+     * \brief Name of the selected kernel
+     */
+    static const char *kernelName() {
+        return name;
+    }
+
+private:
+    typedef size_t (*Kernel)(const uint8_t *data, size_t size);
+
+    //name of the selected kernel
+    static const char *name;
+    //selected kernel
+    static const Kernel kernel;
+
+    /**
+     * Select kernel supported by the CPU
+     */
+    static Kernel select();
+};
+
+#endif // STRING_ESCAPE_H
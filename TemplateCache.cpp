@@ -0,0 +1,134 @@
+#include "TemplateCache.h"
+#include <cstring>
+
+SharedTemplate::SharedTemplate(const fds_template *tmplt,
+                               const ipx_session *session, uint32_t odid) {
+    this->odid = odid;
+    memset(&exporter, 0, sizeof(exporter));
+    const ipx_session_net *net = nullptr;
+    if (session != nullptr) {
+        switch (session->type) {
+            case FDS_SESSION_UDP:
+                net = &session->udp.net;
+                break;
+            case FDS_SESSION_TCP:
+                net = &session->tcp.net;
+                break;
+            case FDS_SESSION_SCTP:
+                net = &session->sctp.net;
+                break;
+            default:
+                break;
+        }
+    }
+    if (net != nullptr && net->l3_proto == AF_INET) {
+        exporter.s6_addr[10] = 0xff;
+        exporter.s6_addr[11] = 0xff;
+        memcpy(&exporter.s6_addr[12], &net->addr_src.ipv4, 4);
+    } else if (net != nullptr) {
+        exporter = net->addr_src.ipv6;
+    }
+    this->tmplt = fds_template_copy(tmplt);
+    if (this->tmplt == nullptr) {
+        throw std::bad_alloc();
+    }
+}
+
+SharedTemplate::~SharedTemplate() {
+    fds_template_destroy(tmplt);
+}
+
+const fds_tfield *SharedTemplate::find(const std::string &name) const {
+    for (uint16_t i = 0; i < tmplt->fields_cnt_total; i++) {
+        const fds_tfield &tfield = tmplt->fields[i];
+        if (name == "en" + std::to_string(tfield.en) + ":id" +
+                    std::to_string(tfield.id)) {
+            return &tfield;
+        }
+        const fds_iemgr_elem *def = tfield.def;
+        if (def != nullptr &&
+            (name == std::string(def->scope->name) + ":" + def->name ||
+             (def->scope->pen == 0 && name == def->name))) {
+            return &tfield;
+        }
+    }
+    return nullptr;
+}
+
+bool TemplateCache::sameDefinition(const fds_template *tmplt,
+                                   const fds_template *cached) {
+    return tmplt->raw.length == cached->raw.length &&
+           memcmp(tmplt->raw.data, cached->raw.data, cached->raw.length) == 0;
+}
+
+std::shared_ptr<const SharedTemplate>
+TemplateCache::get(const ipx_msg_ctx *ctx, const fds_drec *rec) {
+    if (rec->snap != nullptr) {
+        const Key source = {ctx->session, ctx->odid, 0};
+        auto snapshot = snapshots.find(source);
+        if (snapshot == snapshots.end()) {
+            snapshots.emplace(source, rec->snap);
+        } else if (snapshot->second != rec->snap) {
+            snapshot->second = rec->snap;
+            revalidate(ctx->session, ctx->odid, rec->snap);
+        }
+    }
+
+    //addresses of freed templates are reused, so the definition itself is
+    //compared (once per distinct template of a message)
+    const Key key = {ctx->session, ctx->odid, rec->tmplt->id};
+    auto entry = entries.find(key);
+    if (entry != entries.end() && sameDefinition(
+            rec->tmplt, entry->second.shared->tmplt)) {
+        return entry->second.shared;
+    }
+
+    //new or replaced template, messages in flight keep the old one
+    Entry newEntry = {std::make_shared<const SharedTemplate>(rec->tmplt,
+                                                            ctx->session,
+                                                            ctx->odid)};
+    if (entry != entries.end()) {
+        entry->second = newEntry;
+    } else {
+        entries.emplace(key, newEntry);
+    }
+    return newEntry.shared;
+}
+
+void TemplateCache::revalidate(const ipx_session *session, uint32_t odid,
+                               const fds_tsnapshot_t *snap) {
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->first.session != session || it->first.odid != odid) {
+            ++it;
+            continue;
+        }
+
+        const fds_template *current = fds_tsnapshot_template_get(
+                snap, it->first.id);
+        if (current == nullptr ||
+            !sameDefinition(current, it->second.shared->tmplt)) {
+            //withdrawn or replaced
+            it = entries.erase(it);
+            continue;
+        }
+        //unchanged definition, only the snapshot moved on
+        ++it;
+    }
+}
+
+void TemplateCache::removeSession(const ipx_session *session) {
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->first.session == session) {
+            it = entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = snapshots.begin(); it != snapshots.end();) {
+        if (it->first.session == session) {
+            it = snapshots.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
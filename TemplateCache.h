@@ -0,0 +1,149 @@
+#ifndef TEMPLATE_CACHE_H
+#define TEMPLATE_CACHE_H
+
+#include <ipfixcol2.h>
+#include <netinet/in.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * \brief Per-template data of the output converter (e.g. conversion plan)
+ */
+class TemplatePlan {
+public:
+    virtual ~TemplatePlan() = default;
+};
+
+/**
+ * \brief Template shared by all messages that refer to it
+ *
+ * Holds own copy of the template, so it outlives the template snapshot of
+ * the pipeline. Instances are reference counted (std::shared_ptr) and
+ * destroyed when the last message using them is converted.
+ */
+class SharedTemplate final {
+public:
+    /** copy of the template */
+    fds_template *tmplt;
+    /** observation domain ID of the template */
+    uint32_t odid;
+    /** address of the exporter, IPv4 mapped to IPv6 (:: - file session) */
+    in6_addr exporter;
+    /** guards compilation of the plan by the first converting thread */
+    mutable std::once_flag planFlag;
+    /** plan of the output converter, compiled on the first record (shared
+     *  with pending batches of records) */
+    mutable std::shared_ptr<TemplatePlan> plan;
+    /** guards compilation of the fields of message key */
+    mutable std::once_flag keyFlag;
+    /** fields of message key, compiled on the first keyed record */
+    mutable std::unique_ptr<TemplatePlan> keyPlan;
+    /** guards compilation of the routes of records */
+    mutable std::once_flag routeFlag;
+    /** routes of records, compiled on the first routed record */
+    mutable std::unique_ptr<TemplatePlan> routePlan;
+
+    /**
+     * \brief Constructor
+     * @param[in] tmplt template to copy
+     * @param[in] session transport session of the template
+     * @param[in] odid observation domain ID of the template
+     */
+    SharedTemplate(const fds_template *tmplt, const ipx_session *session,
+                   uint32_t odid);
+
+    SharedTemplate(const SharedTemplate &) = delete;
+
+    SharedTemplate &operator=(const SharedTemplate &) = delete;
+
+    /**
+     * \brief Destructor
+     */
+    ~SharedTemplate();
+
+    /**
+     * \brief Find the first field matching the name
+     * @param[in] name "scope:name", "name" of IANA or "enX:idY"
+     * @return field or nullptr
+     */
+    const fds_tfield *find(const std::string &name) const;
+};
+
+/**
+ * \brief Interning cache of templates
+ *
+ * Templates are identified by (transport session, ODID, template ID) and
+ * validated by their definition (raw template), addresses of templates and
+ * snapshots may be reused after they are freed. When a new snapshot
+ * of the same session and ODID appears, withdrawn or replaced templates are
+ * evicted. The cache is used only by the thread of ipx_plugin_process.
+ */
+class TemplateCache final {
+private:
+    struct Key {
+        const ipx_session *session;
+        uint32_t odid;
+        uint16_t id;
+
+        bool operator==(const Key &key) const {
+            return session == key.session && odid == key.odid &&
+                   id == key.id;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            size_t hash = std::hash<const void *>()(key.session);
+            hash ^= (size_t(key.odid) << 16 | key.id) + 0x9e3779b97f4a7c15ULL +
+                    (hash << 6) + (hash >> 2);
+            return hash;
+        }
+    };
+
+    struct Entry {
+        std::shared_ptr<const SharedTemplate> shared;
+    };
+
+    //last seen snapshot of each (session, ODID), template ID is unused
+    std::unordered_map<Key, const fds_tsnapshot_t *, KeyHash> snapshots;
+    std::unordered_map<Key, Entry, KeyHash> entries;
+
+    /**
+     * Check if the template has the same definition as the cached copy
+     * @param[in] tmplt template of the pipeline
+     * @param[in] cached copy of a template
+     */
+    static bool sameDefinition(const fds_template *tmplt,
+                               const fds_template *cached);
+
+    /**
+     * Evict withdrawn and replaced templates of the session and ODID
+     * @param[in] session transport session
+     * @param[in] odid observation domain ID
+     * @param[in] snap new template snapshot
+     */
+    void revalidate(const ipx_session *session, uint32_t odid,
+                    const fds_tsnapshot_t *snap);
+
+public:
+    /**
+     * \brief Get shared template of the record
+     *
+     * @param[in] ctx context of the IPFIX message
+     * @param[in] rec data record
+     * @return shared template
+     */
+    std::shared_ptr<const SharedTemplate> get(const ipx_msg_ctx *ctx,
+                                              const fds_drec *rec);
+
+    /**
+     * \brief Evict all templates of the closed session
+     * @param[in] session transport session
+     */
+    void removeSession(const ipx_session *session);
+};
+
+#endif // TEMPLATE_CACHE_H
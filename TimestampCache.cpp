@@ -0,0 +1,45 @@
+#include "TimestampCache.h"
+#include <ctime>
+
+namespace {
+
+//first second of year 10000
+constexpr uint64_t MAX_SECOND = 253402300800ULL;
+
+inline void writePair(char *out, uint32_t value) {
+    memcpy(out, NumberFormat::digitPairs + value * 2, 2);
+}
+
+} // namespace
+
+TimestampCache::TimestampCache() {
+    for (uint32_t i = 0; i < SLOTS; i++) {
+        seconds[i] = UINT64_MAX;
+    }
+}
+
+bool TimestampCache::fill(uint64_t second, char *prefix) {
+    if (second >= MAX_SECOND) {
+        return false;
+    }
+    const time_t time = second;
+    struct tm tm;
+    if (gmtime_r(&time, &tm) == nullptr) {
+        return false;
+    }
+
+    const uint32_t year = tm.tm_year + 1900;
+    writePair(prefix, year / 100);
+    writePair(prefix + 2, year % 100);
+    prefix[4] = '-';
+    writePair(prefix + 5, tm.tm_mon + 1);
+    prefix[7] = '-';
+    writePair(prefix + 8, tm.tm_mday);
+    prefix[10] = 'T';
+    writePair(prefix + 11, tm.tm_hour);
+    prefix[13] = ':';
+    writePair(prefix + 14, tm.tm_min);
+    prefix[16] = ':';
+    writePair(prefix + 17, tm.tm_sec);
+    return true;
+}
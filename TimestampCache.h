@@ -0,0 +1,68 @@
+#ifndef TIMESTAMP_CACHE_H
+#define TIMESTAMP_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "NumberFormat.h"
+
+/**
+ * \brief Cache of formatted timestamps of one thread
+ *
+ * Timestamps of flows in one IPFIX message mostly fall into a few seconds,
+ * so the calendar part "YYYY-MM-DDTHH:MM:SS" is formatted once per second
+ * and kept in a small direct-mapped cache. Only the milliseconds are written
+ * per field. Output is identical to fds_datetime2str_be with
+ * FDS_CONVERT_TF_MSEC_UTC.
+ */
+class TimestampCache final {
+public:
+    /** length of "YYYY-MM-DDTHH:MM:SS"                                    */
+    static constexpr size_t PREFIX_LENGTH = 19;
+    /** length of "YYYY-MM-DDTHH:MM:SS.mmmZ"                               */
+    static constexpr size_t LENGTH = PREFIX_LENGTH + 5;
+
+    TimestampCache();
+
+    /**
+     * \brief Write timestamp
+     *
+     * @param[in] msec milliseconds since the epoch
+     * @param[out] out output (at least LENGTH chars)
+     * @return number of written chars or -1 if the year is out of range
+     */
+    int write(uint64_t msec, char *out) {
+        const uint64_t second = msec / 1000;
+        const uint32_t slot = second % SLOTS;
+        if (seconds[slot] != second) {
+            if (!fill(second, prefixes[slot])) {
+                return -1;
+            }
+            seconds[slot] = second;
+        }
+        memcpy(out, prefixes[slot], PREFIX_LENGTH);
+
+        const uint32_t millis = msec % 1000;
+        char *pos = out + PREFIX_LENGTH;
+        pos[0] = '.';
+        pos[1] = char('0' + millis / 100);
+        memcpy(pos + 2, NumberFormat::digitPairs + (millis % 100) * 2, 2);
+        pos[4] = 'Z';
+        return LENGTH;
+    }
+
+private:
+    static constexpr uint32_t SLOTS = 4;
+
+    //epoch seconds of cached prefixes
+    uint64_t seconds[SLOTS];
+    char prefixes[SLOTS][PREFIX_LENGTH];
+
+    /**
+     * Format calendar part of the second
+     * @return false if the year has more than 4 digits
+     */
+    static bool fill(uint64_t second, char *prefix);
+};
+
+#endif // TIMESTAMP_CACHE_H
@@ -0,0 +1,109 @@
+#include "TopicRouter.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+TopicRouter::TopicRouter(std::shared_ptr<ConfigKafka> configKafka) {
+    routes = configKafka->routes;
+    topics.push_back(configKafka->topicList);
+    for (const ConfigRoute &route : routes) {
+        auto it = std::find(topics.begin(), topics.end(), route.topic);
+        routeTopics.push_back(it - topics.begin());
+        if (it == topics.end()) {
+            topics.push_back(route.topic);
+        }
+    }
+}
+
+bool TopicRouter::matches(const ConfigRoute &route,
+                          const SharedTemplate *shared) {
+    if (!route.exporters.empty() &&
+        std::none_of(route.exporters.begin(), route.exporters.end(),
+                     [shared](const in6_addr &address) {
+                         return memcmp(&address, &shared->exporter,
+                                       sizeof(address)) == 0;
+                     })) {
+        return false;
+    }
+    if (!route.odids.empty() &&
+        std::find(route.odids.begin(), route.odids.end(), shared->odid) ==
+        route.odids.end()) {
+        return false;
+    }
+    if (!route.templates.empty() &&
+        std::find(route.templates.begin(), route.templates.end(),
+                  shared->tmplt->id) == route.templates.end()) {
+        return false;
+    }
+    const bool options = shared->tmplt->type == FDS_TYPE_TEMPLATE_OPTS;
+    return route.records == RECORDS_ALL ||
+           options == (route.records == RECORDS_OPTIONS);
+}
+
+std::unique_ptr<RoutePlan>
+TopicRouter::compile(const SharedTemplate *shared) const {
+    std::unique_ptr<RoutePlan> plan = std::make_unique<RoutePlan>();
+    plan->dynamic = (shared->tmplt->flags & FDS_TEMPLATE_DYNAMIC) != 0;
+    plan->fallback = 0;
+
+    for (size_t i = 0; i < routes.size(); i++) {
+        const ConfigRoute &route = routes[i];
+        if (!matches(route, shared)) {
+            continue;
+        }
+        //following routes are not reachable
+        if (route.field.empty()) {
+            plan->fallback = routeTopics[i];
+            break;
+        }
+        const fds_tfield *tfield = shared->find(route.field);
+        if (tfield == nullptr) {
+            continue;
+        }
+
+        //consecutive routes of one field share the lookup
+        if (plan->steps.empty() || plan->steps.back().en != tfield->en ||
+            plan->steps.back().id != tfield->id) {
+            RoutePlan::Step step;
+            step.en = tfield->en;
+            step.id = tfield->id;
+            step.offset = tfield->offset;
+            step.length = tfield->length;
+            plan->steps.push_back(step);
+        }
+        for (uint64_t value : route.values) {
+            plan->steps.back().topics.emplace(value, routeTopics[i]);
+        }
+    }
+    return plan;
+}
+
+uint16_t TopicRouter::route(const SharedTemplate *shared,
+                            fds_drec *rec) const {
+    std::call_once(shared->routeFlag, [this, shared] {
+        shared->routePlan = compile(shared);
+    });
+    const RoutePlan *plan = static_cast<const RoutePlan *>(
+            shared->routePlan.get());
+
+    for (const RoutePlan::Step &step : plan->steps) {
+        fds_drec_field field;
+        if (plan->dynamic) {
+            if (fds_drec_find(rec, step.en, step.id, &field) == FDS_EOC) {
+                continue;
+            }
+        } else {
+            field.data = rec->data + step.offset;
+            field.size = step.length;
+        }
+        uint64_t value;
+        if (fds_get_uint_be(field.data, field.size, &value) != FDS_OK) {
+            continue;
+        }
+        auto topic = step.topics.find(value);
+        if (topic != step.topics.end()) {
+            return topic->second;
+        }
+    }
+    return plan->fallback;
+}
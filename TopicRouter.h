@@ -0,0 +1,98 @@
+#ifndef TOPIC_ROUTER_H
+#define TOPIC_ROUTER_H
+
+#include <ipfixcol2.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Config.h"
+#include "TemplateCache.h"
+
+/**
+ * \brief Routes of records of one template
+ *
+ * Generated on the first record of the template. Conditions on exporter,
+ * ODID, template ID and type of records are decided once per template, only
+ * comparisons of field values remain for each record.
+ */
+class RoutePlan final : public TemplatePlan {
+public:
+    /** Comparison of field value with values of consecutive routes */
+    struct Step {
+        /** enterprise number of the field                                 */
+        uint32_t en;
+        /** ID of the field                                                */
+        uint16_t id;
+        /** offset of the field in record (static templates only)          */
+        uint16_t offset;
+        /** length of the field (static templates only)                    */
+        uint16_t length;
+        /** topic by value (the first route of the value)                  */
+        std::unordered_map<uint64_t, uint16_t> topics;
+    };
+
+    /** template has variable-length fields                                */
+    bool dynamic;
+    /** comparisons in order of routes                                     */
+    std::vector<Step> steps;
+    /** topic of records without matching comparison                       */
+    uint16_t fallback;
+};
+
+/**
+ * \brief Routing of records to topics
+ *
+ * Topics are identified by index, index 0 is the default topic (topicList)
+ * used by records without matching route. The producer keeps a topic handle
+ * for each index.
+ */
+class TopicRouter final {
+private:
+    std::vector<ConfigRoute> routes;
+    //names of topics, default topic first
+    std::vector<std::string> topics;
+    //index of topic of each route
+    std::vector<uint16_t> routeTopics;
+
+    /**
+     * Check conditions of the route decided by template
+     * @param[in] route route
+     * @param[in] shared template
+     */
+    static bool matches(const ConfigRoute &route,
+                        const SharedTemplate *shared);
+
+    /**
+     * Generate routes of the template
+     * @param[in] shared template
+     * @return routes of the template
+     */
+    std::unique_ptr<RoutePlan> compile(const SharedTemplate *shared) const;
+
+public:
+    /**
+     * \brief Constructor
+     * @param[in] configKafka configuration of kafka (default topic, routes)
+     */
+    explicit TopicRouter(std::shared_ptr<ConfigKafka> configKafka);
+
+    /**
+     * \brief Names of topics by index
+     */
+    const std::vector<std::string> &getTopics() const {
+        return topics;
+    }
+
+    /**
+     * \brief Select topic of the record
+     *
+     * @param[in] shared template of the record
+     * @param[in] rec record
+     * @return index of topic
+     */
+    uint16_t route(const SharedTemplate *shared, fds_drec *rec) const;
+};
+
+#endif // TOPIC_ROUTER_H
@@ -1,7 +1,11 @@
 #include "Worker.h"
+#include "StringEscape.h"
 #include "../../../core/message_ipfix.h"
 #include <thread>
+#include <chrono>
+#include <algorithm>
 #include <iostream>
+#include <vector>
 #include <libfds.h>
 
 
@@ -14,40 +18,21 @@ Worker::Worker(std::shared_ptr<ConfigFormat> configFormat,
     this->configProcessing = configProcessing;
 
 
-    flags = FDS_CD2J_ALLOW_REALLOC;
-    if (configFormat->tcp_flags) {
-        flags |= FDS_CD2J_FORMAT_TCPFLAGS;
-    }
-    if (configFormat->timestamp) {
-        flags |= FDS_CD2J_TS_FORMAT_MSEC;
-    }
-    if (configFormat->proto) {
-        flags |= FDS_CD2J_FORMAT_PROTO;
-    }
-    if (configFormat->ignore_unknown) {
-        flags |= FDS_CD2J_IGNORE_UNKNOWN;
-    }
-    if (!configFormat->white_spaces) {
-        flags |= FDS_CD2J_NON_PRINTABLE;
-    }
-    if (configFormat->numeric_names) {
-        flags |= FDS_CD2J_NUMERIC_ID;
-    }
-    if (configFormat->split_biflow) {
-        flags |= FDS_CD2J_REVERSE_SKIP;
-    }
-    if (!configFormat->octets_as_uint) {
-        flags |= FDS_CD2J_OCTETS_NOINT;
-    }
-
     workerThreadsCount = std::thread::hardware_concurrency();
+    //0 if the number of hardware threads is not known
+    if(workerThreadsCount < 1){
+        workerThreadsCount = 1;
+    }
+    //Arrow converter batches records by template itself
+    isBatching = configProcessing->batchMaxRecords > 1 &&
+                 configFormat->output == OUTPUT_JSON;
 
     init();
 }
 
 Worker::Worker(const Worker &w) {
     workerThreadsCount = w.workerThreadsCount;
-    flags = w.flags;
+    isBatching = w.isBatching;
 
     configFormat = w.configFormat;
     configKafka = w.configKafka;
@@ -58,26 +43,80 @@ Worker::Worker(const Worker &w) {
 
 void Worker::init() {
 
-    indexProcess = 0;
-    indexAdd = 0;
-    restartIndexAdd = false;
     isPluginRunning = false;
     isKafkaProducerConnected = false;
 
+    if (configFormat->output == OUTPUT_AVRO) {
+        converter = std::make_unique<AvroConverter>(configFormat);
+    } else if (configFormat->output == OUTPUT_ARROW) {
+        converter = std::make_unique<ArrowConverter>(configFormat,
+                                                     configProcessing);
+    } else if (configFormat->output == OUTPUT_MSGPACK ||
+               configFormat->output == OUTPUT_CBOR) {
+        converter = std::make_unique<PackedConverter>(
+                configFormat, configFormat->output == OUTPUT_CBOR);
+    } else {
+        //templates of compact records are published by the producer
+        converter = std::make_unique<JsonConverter>(
+                configFormat, configProcessing,
+                [this](const std::string &key, const std::string &value) {
+                    return kafkaProducer->sendTemplate(key, value);
+                });
+    }
+
+    bufferPool = std::make_shared<BufferPool>(
+            configProcessing->bufferPoolSize,
+            configProcessing->processMessageLength,
+            configProcessing->bufferShrinkMs);
+
+    //topics of routes follow the default topic
+    std::vector<std::string> topics = {configKafka->topicList};
+    if (!configKafka->routes.empty()) {
+        router = std::make_unique<TopicRouter>(configKafka);
+        topics = router->getTopics();
+    }
+
+    if (configKafka->messageKey != KEY_NONE) {
+        messageKey = std::make_unique<MessageKey>(configKafka);
+    }
+
+    if (configProcessing->compression) {
+        compressor = std::make_unique<ZstdCompressor>(
+                bufferPool, configProcessing->zstdLevel,
+                configProcessing->zstdDictionary,
+                configProcessing->zstdTrainSamples);
+    }
+
     kafkaProducer = std::make_unique<KafkaProducer>
             (KafkaProducer(configKafka->hostName, configKafka->port,
-                           configKafka->topicList));
-
-    msgs = std::make_unique<std::unique_ptr<WorkerMsg>[]>
-            (configProcessing->messagesBufferSize);
+                           topics, configKafka->templateTopic,
+                           configKafka->properties, bufferPool));
+
+    indexDispatch = 0;
+    if (configProcessing->workStealing) {
+        //the input buffer is split among threads
+        const uint32_t size = std::max<uint32_t>(
+                configProcessing->messagesBufferSize / workerThreadsCount,
+                16);
+        for (uint32_t i = 0; i < workerThreadsCount; i++) {
+            msgs.push_back(std::make_unique<MpmcQueue<
+                    std::unique_ptr<WorkerMsg>>>(size));
+        }
+    } else {
+        msgs.push_back(std::make_unique<MpmcQueue<
+                std::unique_ptr<WorkerMsg>>>(
+                configProcessing->messagesBufferSize));
+    }
 
     processMsgsBuffer = std::make_unique<std::unique_ptr<ProcessMsgBuffer>[]>
             (workerThreadsCount);
     for (uint32_t i = 0; i < workerThreadsCount; i++) {
-        processMsgsBuffer[i] = std::make_unique<ProcessMsgBuffer>
-                (ProcessMsgBuffer(configProcessing->processMessageLength));
+        processMsgsBuffer[i] = std::make_unique<ProcessMsgBuffer>(
+                bufferPool);
     }
 
+    syncMsgBuffer = std::make_unique<ProcessMsgBuffer>(bufferPool);
+
     workerThreads = new std::thread[workerThreadsCount];
 }
 
@@ -93,37 +132,64 @@ Worker::~Worker() {
 }
 
 void Worker::addMsg(std::unique_ptr<WorkerMsg> msg) {
-    lck.lock();
-    while (msgs[indexAdd].get() != nullptr) {
+    if (msg->structured) {
+        //lists are decoded by the snapshot, nothing is left in the buffer
+        processMessage(std::move(msg), syncMsgBuffer.get());
+        flush(syncMsgBuffer.get());
+        drain(syncMsgBuffer.get(), true);
+        return;
+    }
+
+    const uint32_t index = dispatch(msg.get());
+    if (!msgs[index]->tryPush(msg)) {
         Logger::logWarning("Buffer is full");
+        do {
+            //timeout covers notification between failed push and wait
+            std::unique_lock<std::mutex> lock(inputMtx);
+            inputCV.wait_for(lock, std::chrono::milliseconds(1));
+        } while (!msgs[index]->tryPush(msg));
+    }
+    workerCV.notify_one();
+}
 
-        lck.unlock();
-        std::unique_lock<std::mutex> lock(inputMtx);
-        inputCV.wait(lock);
-        lck.lock();
+uint32_t Worker::dispatch(const WorkerMsg *msg) {
+    if (msgs.size() == 1) {
+        return 0;
     }
+    if (configProcessing->dispatchByOdid) {
+        //messages of one ODID stay on one thread unless they are stolen
+        return (msg->odid * 2654435761U) % msgs.size();
+    }
+    return indexDispatch++ % msgs.size();
+}
 
-    msgs[indexAdd] = std::move(msg);
-    if (indexAdd + 1 < configProcessing->messagesBufferSize) {
-        indexAdd++;
-    } else {
-        indexAdd = 0;
-        restartIndexAdd = true;
+bool Worker::isInputEmpty() const {
+    for (const auto &queue : msgs) {
+        if (!queue->empty()) {
+            return false;
+        }
     }
-    lck.unlock();
-    workerCV.notify_one();
+    return true;
 }
 
 
-void Worker::start() {
-    Logger::logInfo("Plugin JsonToKafka started");
+bool Worker::start() {
     isKafkaProducerConnected = kafkaProducer->connect();
+    //threads would send by a producer which does not exist
+    if (!isKafkaProducerConnected) {
+        Logger::logError("Plugin JsonToKafka not started, kafka producer "
+                         "is not created");
+        return false;
+    }
+    Logger::logInfo("Plugin JsonToKafka started");
+    Logger::logInfo(std::string("String escaping kernel: ") +
+                    StringEscape::kernelName());
     isPluginRunning = true;
     for (uint32_t i = 0; i < workerThreadsCount; i++) {
-        workerThreads[i] = std::thread(&Worker::work, this,
-                                       processMsgsBuffer[i]->buffer,
-                                       &processMsgsBuffer[i]->size);
+        workerThreads[i] = std::thread(&Worker::work, this, i,
+                                       processMsgsBuffer[i].get());
     }
+    return true;
 }
 
 void Worker::stop() {
@@ -135,75 +201,156 @@ void Worker::stop() {
     }
 }
 
-void Worker::work(char *processMsgBuffer, size_t *processMsgBufferSize) {
+void Worker::work(uint32_t threadIndex, ProcessMsgBuffer *processMsgBuffer) {
+    const uint32_t queueCount = msgs.size();
+    const uint32_t ownIndex = threadIndex % queueCount;
+    std::unique_ptr<WorkerMsg> msg;
     while (isPluginRunning) {
-        lck.lock();
-        if ((indexProcess < indexAdd || restartIndexAdd) &&
-        msgs[indexProcess].get() != nullptr) {
-            std::unique_ptr<WorkerMsg> msg = std::move(msgs[indexProcess]);
-            uint32_t indexCurrentMsg = indexProcess;
-            if (indexProcess + 1 < configProcessing->messagesBufferSize) {
-                indexProcess++;
-            } else {
-                indexProcess = 0;
-                restartIndexAdd = false;
-            }
-            lck.unlock();
-            processMessage(std::move(msg), processMsgBuffer,
-                           processMsgBufferSize,
-                           indexCurrentMsg);
-            inputCV.notify_all();
+        //own input buffer first, then neighbours
+        bool found = false;
+        for (uint32_t i = 0; i < queueCount && !found; i++) {
+            found = msgs[(ownIndex + i) % queueCount]->tryPop(msg);
+        }
 
+        if (found) {
+            processMessage(std::move(msg), processMsgBuffer);
+            inputCV.notify_one();
         } else {
-            lck.unlock();
+            //timeout covers notification between failed pop and wait
             std::unique_lock<std::mutex> lock(workerMtx);
-            workerCV.wait(lock);
+            workerCV.wait_for(lock, std::chrono::milliseconds(10), [this] {
+                return !isInputEmpty() || !isPluginRunning;
+            });
+            lock.unlock();
+
+            if (isLingerExpired(processMsgBuffer)) {
+                flush(processMsgBuffer);
+            }
+            drain(processMsgBuffer, false);
         }
     }
+
+    //send the rest of batch
+    flush(processMsgBuffer);
+    drain(processMsgBuffer, true);
 }
 
 int Worker::processMessage(std::unique_ptr<WorkerMsg> msg,
-                           char *processMsgBuffer,
-                           size_t *processMsgBufferSize,
-                           uint32_t indexCurrentMsg) {
+                           ProcessMsgBuffer *processMsgBuffer) {
 
     //int returnCode = IPX_OK;
-    const uint32_t recordSize = ipx_msg_ipfix_get_drec_cnt(msg->ipfix_msg);
-    uint32_t messageLen = 0;
-    for (uint32_t i = 0; i < recordSize; i++) {
-        //get record from message
-        ipx_ipfix_record *recordIpfix = ipx_msg_ipfix_get_drec(
-                msg->ipfix_msg, i);
+    int messageLen = 0;
+    //batch has one key, records of other exporter start a new one
+    if (isBatching && messageKey && processMsgBuffer->records > 0 &&
+        processMsgBuffer->odid != msg->odid) {
+        flush(processMsgBuffer);
+    }
+    processMsgBuffer->odid = msg->odid;
+
+    for (size_t i = 0; i < msg->records.size(); i++) {
+        fds_drec &rec = msg->records[i];
         if (configFormat->ignore_options &&
-            recordIpfix->rec.tmplt->type == FDS_TYPE_TEMPLATE_OPTS) {
+            rec.tmplt->type == FDS_TYPE_TEMPLATE_OPTS) {
             continue;
         }
-        messageLen = convertMessage(&recordIpfix->rec, msg->iemgr,
-                                    processMsgBuffer,
-                                    processMsgBufferSize);
-        if (messageLen >= 0) {
-            lckSend.lock();
-            kafkaProducer->sendMessage(processMsgBuffer, messageLen);
-            lckSend.unlock();
-        } else {
-            Logger::logError("Error conversion: error code = " + messageLen);
+
+        //batch is sent to one topic
+        const SharedTemplate *shared = msg->recordTemplates[i];
+        const uint16_t topic = router ? router->route(shared, &rec) : 0;
+        if (isBatching && processMsgBuffer->records > 0 &&
+            processMsgBuffer->buffer->topic != topic) {
+            flush(processMsgBuffer);
+        }
+
+        OutputBuffer *buffer = processMsgBuffer->buffer;
+        buffer->topic = topic;
+        const size_t start = buffer->length;
+        messageLen = convertMessage(&rec, shared, msg->iemgr,
+                                    processMsgBuffer);
+        if (messageLen < 0) {
+            buffer->length = start;
+            Logger::logError("Error conversion: error code = " +
+                             std::to_string(messageLen));
+            continue;
+        }
+        if (messageKey) {
+            //from raw record, the same for all records of batch
+            messageKey->build(shared, &rec, msg->odid, buffer->key);
+        }
+
+        if (!isBatching) {
+            //producer is thread-safe, threads send concurrently; buffer is
+            //handed over without copying
+            flush(processMsgBuffer);
+            continue;
         }
 
-        //delete record
-        free(recordIpfix->rec.data);
-        fds_template_destroy(
-                const_cast<fds_template *>(recordIpfix->rec.tmplt));
+        //newline-delimited JSON
+        if (!buffer->reserve(1)) {
+            buffer->length = start;
+            Logger::logError("Error conversion: out of memory");
+            continue;
+        }
+        buffer->data[buffer->length++] = '\n';
+        if (processMsgBuffer->records++ == 0) {
+            processMsgBuffer->started = std::chrono::steady_clock::now();
+        }
+
+        //size limit is the only reason to split records of one message
+        if (buffer->length >= configProcessing->batchMaxBytes) {
+            flush(processMsgBuffer);
+        }
     }
 
-    ipx_msg_destroy((ipx_msg *) msg->ipfix_msg);
+    //other limits are checked on the boundary of IPFIX messages
+    if (isBatching &&
+        (processMsgBuffer->records >= configProcessing->batchMaxRecords ||
+         isLingerExpired(processMsgBuffer))) {
+        flush(processMsgBuffer);
+    }
+    drain(processMsgBuffer, false);
+
+    //records (and borrowed message) are released with the wrapper
     return IPX_OK;
 }
 
+void Worker::flush(ProcessMsgBuffer *processMsgBuffer) {
+    if (processMsgBuffer->buffer->length == 0) {
+        return;
+    }
+    OutputBuffer *message = processMsgBuffer->take();
+    if (compressor) {
+        //compressed in parallel by conversion threads
+        message = compressor->compress(
+                message, &processMsgBuffer->compressionContext);
+    }
+    kafkaProducer->sendMessage(message);
+}
+
+void Worker::drain(ProcessMsgBuffer *processMsgBuffer, bool all) {
+    int messageLen;
+    while ((messageLen = converter->drain(processMsgBuffer->buffer,
+                                          &processMsgBuffer->converterState,
+                                          all)) != 0) {
+        if (messageLen < 0) {
+            Logger::logError("Error conversion: error code = " +
+                             std::to_string(messageLen));
+            continue;
+        }
+        flush(processMsgBuffer);
+    }
+}
+
+bool Worker::isLingerExpired(const ProcessMsgBuffer *processMsgBuffer) const {
+    return processMsgBuffer->records > 0 &&
+           std::chrono::steady_clock::now() - processMsgBuffer->started >=
+           std::chrono::milliseconds(configProcessing->batchLingerMs);
+}
+
 
-uint32_t Worker::convertMessage(fds_drec *rec, const fds_iemgr_t *iemgr,
-                                char *processMsgBuffer, size_t *
-processMsgBufferSize) {
-    //record conversion
-    return fds_drec2json(rec, flags, iemgr, &processMsgBuffer,
-                         processMsgBufferSize);
+int Worker::convertMessage(fds_drec *rec, const SharedTemplate *shared,
+                           const fds_iemgr_t *iemgr,
+                           ProcessMsgBuffer *processMsgBuffer) {
+    return converter->convert(shared, rec, iemgr, processMsgBuffer->buffer,
+                              &processMsgBuffer->converterState);
 }
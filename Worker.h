@@ -7,78 +7,104 @@
 #include <ipfixcol2.h>
 #include <thread>
 #include <atomic>
+#include <chrono>
 #include "Config.h"
+#include "ArrowConverter.h"
+#include "AvroConverter.h"
+#include "JsonConverter.h"
 #include "KafkaProducer.h"
 #include "Logger.h"
+#include "MessageKey.h"
+#include "TopicRouter.h"
+#include "MpmcQueue.h"
+#include "PackedConverter.h"
+#include "WorkerMsg.h"
+#include "ZstdCompressor.h"
 #include <string>
 #include <vector>
 #include "../../../core/message_ipfix.h"
 
 
-/**
- * Wraper for IPFIX message and iemgr
- */
-class WorkerMsg final {
-public:
-    ipx_msg_ipfix_t *ipfix_msg;
-    const fds_iemgr_t *iemgr;
-
-    WorkerMsg(ipx_msg_ipfix_t *ipfix_msg, const fds_iemgr_t *iemgr) {
-        this->ipfix_msg = ipfix_msg;
-        this->iemgr = iemgr;
-    }
-};
-
 /**
  * wrapper for conversion buffer
+ *
+ * Holds output buffer of the thread taken from the pool. Records are
+ * converted directly into it (one record or a batch of records) and the
+ * buffer is handed over to the producer, so the thread takes a new one from
+ * the pool.
  */
 class ProcessMsgBuffer final {
 public:
-    char *buffer;
-    size_t size;
-
-    ProcessMsgBuffer(size_t size) {
-        this->buffer = new char[size];
-        this->size = size;
+    std::shared_ptr<BufferPool> pool;
+    OutputBuffer *buffer;
+    //number of records in buffer
+    uint32_t records;
+    //observation domain ID of records in buffer (batches keyed by ODID)
+    uint32_t odid;
+    //time of the first record in buffer
+    std::chrono::steady_clock::time_point started;
+    //state of the converter for the thread
+    ConverterState converterState;
+    //compression context for the thread
+    CompressionContext compressionContext;
+
+    ProcessMsgBuffer(std::shared_ptr<BufferPool> pool) {
+        this->pool = pool;
+        this->buffer = pool->acquire();
+        this->records = 0;
+        this->odid = 0;
     }
 
-    ProcessMsgBuffer(const ProcessMsgBuffer &ins) {
-        this->size = ins.size;
-        this->buffer = new char[size];
+    ProcessMsgBuffer(const ProcessMsgBuffer &ins) = delete;
+
+    /**
+     * Hand over current buffer and take new one from the pool
+     * @return filled buffer
+     */
+    OutputBuffer *take() {
+        OutputBuffer *filled = buffer;
+        buffer = pool->acquire();
+        records = 0;
+        return filled;
     }
 
     ~ProcessMsgBuffer() {
-        delete[] buffer;
+        pool->release(buffer);
     }
 };
 
 class Worker final {
 private:
-    //input buffer for conversion
-    std::unique_ptr<std::unique_ptr<WorkerMsg>[]> msgs;
+    //input buffers for conversion (lock-free ring buffers), one shared by
+    //all threads or one per thread (work stealing)
+    std::vector<std::unique_ptr<MpmcQueue<std::unique_ptr<WorkerMsg>>>> msgs;
+    //next input buffer for round-robin distribution
+    std::atomic_uint32_t indexDispatch;
+    //pool of output buffers shared with kafka producer
+    std::shared_ptr<BufferPool> bufferPool;
     //buffer for conversion
     std::unique_ptr<std::unique_ptr<ProcessMsgBuffer>[]> processMsgsBuffer;
+    //buffer for messages converted by the thread of ipx_plugin_process
+    std::unique_ptr<ProcessMsgBuffer> syncMsgBuffer;
 
-    //current index for add message
-    std::atomic_uint32_t indexAdd;
-    //current index for process message
-    std::atomic_uint32_t indexProcess;
+    //converter of records shared by all threads
+    std::unique_ptr<RecordConverter> converter;
+    //routes of records to topics, nullptr if all go to the default topic
+    std::unique_ptr<TopicRouter> router;
+    //key of messages, nullptr if messages are not keyed
+    std::unique_ptr<MessageKey> messageKey;
+    //compression of messages, nullptr if disabled
+    std::unique_ptr<ZstdCompressor> compressor;
 
-    //due to ring buffer
-    std::atomic_bool restartIndexAdd;
-
-    //settings json format for libfds (fds_drec2json)
-    uint32_t flags;
+    //records are batched (newline-delimited) into one kafka message
+    bool isBatching;
 
     uint32_t workerThreadsCount;
 
     std::thread *workerThreads;
 
+    //locks only for sleeping on empty / full input buffer
     std::mutex workerMtx;
-    //lock for critical section "addMsg" and "work"
-    std::mutex lck;
-    //lock for sender
-    std::mutex lckSend;
 
     std::mutex inputMtx;
 
@@ -95,40 +121,74 @@ private:
 
     /**
      * Select message for conversion and starts conversion, if input buffer
-     * is empty wait
+     * is empty steal from input buffers of other threads, if all are empty
+     * wait
      *
+     * @param[in] threadIndex index of thread (and its own input buffer)
      * @param[in] processMsgBuffer converted msg buffer for thread instance
-     * @param[in] processMsgBufferSize size msg buffer for thread instance
      */
-    void work(char *processMsgBuffer, size_t *processMsgBufferSize);
+    void work(uint32_t threadIndex, ProcessMsgBuffer *processMsgBuffer);
+
+    /**
+     * Select input buffer for new message
+     *
+     * @param[in] msg new message
+     * @return index of input buffer
+     */
+    uint32_t dispatch(const WorkerMsg *msg);
+
+    /**
+     * Check if all input buffers seem empty
+     */
+    bool isInputEmpty() const;
 
     /**
      * Splits message to records and after full process delete workerMsg
      *
      * @param[in] workerMsg message for conversion
      * @param[in] msgBuffer buffer for conversion
-     * @param[in] convMsgBufferSize size of buffer for conversion
-     * @param[in] indexCurrentMsg current index message for conversion (later
-     * save to output buffer)
      * @return state code
      */
     int
-    processMessage(std::unique_ptr<WorkerMsg> workerMsg, char *msgBuffer,
-                   size_t *convMsgBufferSize, uint32_t indexCurrentMsg);
+    processMessage(std::unique_ptr<WorkerMsg> workerMsg,
+                   ProcessMsgBuffer *msgBuffer);
+
+    /**
+     * Send buffer of the thread (single record or batch) if not empty,
+     * the message is compressed by the thread if enabled
+     *
+     * @param[in] msgBuffer buffer for conversion
+     */
+    void flush(ProcessMsgBuffer *msgBuffer);
+
+    /**
+     * Send batches buffered by the converter (e.g. Arrow), each batch in its
+     * own kafka message
+     *
+     * @param[in] msgBuffer buffer for conversion
+     * @param[in] all send all batches, otherwise only expired ones
+     */
+    void drain(ProcessMsgBuffer *msgBuffer, bool all);
+
+    /**
+     * Check if the batch in buffer waits longer than allowed
+     *
+     * @param[in] msgBuffer buffer for conversion
+     */
+    bool isLingerExpired(const ProcessMsgBuffer *msgBuffer) const;
 
     /**
      * Conversions single records and save it
      *
+     * Converted record is appended after used bytes of the buffer.
      * @param rec[in] record for conversion
+     * @param shared[in] shared template of the record
      * @param iemgr[in] Information element manager
-     * @param processMsgBuffer[in, out] buffer for conversion record
-     * @param processMsgBufferSize[in, out] size of buffer for conversion record
-     * @param convertedMsg[in] final converted message
-     * @return number of chars in procesMsgBuffer
+     * @param msgBuffer[in, out] buffer for conversion record (may grow)
+     * @return number of appended chars or negative error code
      */
-    uint32_t convertMessage(fds_drec *rec, const fds_iemgr_t *iemgr, char *
-    processMsgBuffer,
-                            size_t *processMsgBufferSize);
+    int convertMessage(fds_drec *rec, const SharedTemplate *shared,
+                       const fds_iemgr_t *iemgr, ProcessMsgBuffer *msgBuffer);
 
     /**
      * Init due to smart pointer
@@ -156,7 +216,9 @@ public:
     /**
      * \brief Add msg to input buffer
      *
-     * Add msg to input buffer. If input buffer is full, msg rewrite old msg.
+     * Add msg to input buffer. If input buffer is full, wait for a free slot.
+     * Messages with structured fields are converted and sent immediately,
+     * their template snapshot is not valid later.
      * @param[in] msg Message for conversion to json
      */
     void addMsg(std::unique_ptr<WorkerMsg> msg);
@@ -166,8 +228,9 @@ public:
      *
      * Fill worker threads pool, create sender thread and connect kafka producer
      * module
+     * @return false if kafka producer is not created (no threads are started)
      */
-    void start();
+    bool start();
 
     /**
      * \brief Stop plugin
@@ -0,0 +1,92 @@
+#include "WorkerMsg.h"
+#include "../../../core/message_ipfix.h"
+#include <cstdlib>
+#include <cstring>
+
+WorkerMsg::WorkerMsg(ipx_msg_ipfix_t *ipfix_msg, const fds_iemgr_t *iemgr,
+                     TemplateCache &templateCache, bool zeroCopy) {
+    this->iemgr = iemgr;
+    this->odid = ipx_msg_ipfix_get_ctx(ipfix_msg)->odid;
+    this->ipfix_msg = nullptr;
+    this->arena = nullptr;
+    this->structured = false;
+
+    if (zeroCopy) {
+        borrow(ipfix_msg);
+    } else {
+        copy(ipfix_msg);
+    }
+    shareTemplates(ipfix_msg, templateCache);
+}
+
+WorkerMsg::~WorkerMsg() {
+    if (ipfix_msg == nullptr) {
+        //copied records
+        free(arena);
+        return;
+    }
+
+    //release reference, the last owner destroys the message
+    if (__atomic_sub_fetch(&ipfix_msg->msg_header.ref_cnt, 1,
+                           __ATOMIC_ACQ_REL) == 0) {
+        ipx_msg_destroy(ipx_msg_ipfix2base(ipfix_msg));
+    }
+}
+
+void WorkerMsg::borrow(ipx_msg_ipfix_t *msg) {
+    //the pipeline destroys the message when the last reference is released,
+    //so an extra reference keeps raw_pkt (and record data) alive after
+    //ipx_plugin_process returns
+    __atomic_add_fetch(&msg->msg_header.ref_cnt, 1, __ATOMIC_ACQ_REL);
+    ipfix_msg = msg;
+
+    const uint32_t recordCnt = ipx_msg_ipfix_get_drec_cnt(msg);
+    records.reserve(recordCnt);
+    for (uint32_t i = 0; i < recordCnt; i++) {
+        records.push_back(ipx_msg_ipfix_get_drec(msg, i)->rec);
+    }
+}
+
+void WorkerMsg::copy(ipx_msg_ipfix_t *msg) {
+    const uint32_t recordCnt = ipx_msg_ipfix_get_drec_cnt(msg);
+    records.reserve(recordCnt);
+
+    size_t arenaSize = 0;
+    for (uint32_t i = 0; i < recordCnt; i++) {
+        arenaSize += ipx_msg_ipfix_get_drec(msg, i)->rec.size;
+    }
+    arena = (uint8_t *) malloc(arenaSize);
+
+    uint8_t *pos = arena;
+    for (uint32_t i = 0; i < recordCnt; i++) {
+        const fds_drec &src = ipx_msg_ipfix_get_drec(msg, i)->rec;
+
+        fds_drec rec = src;
+        rec.data = pos;
+        memcpy(rec.data, src.data, src.size);
+        pos += src.size;
+        records.push_back(rec);
+    }
+}
+
+void WorkerMsg::shareTemplates(ipx_msg_ipfix_t *msg,
+                               TemplateCache &templateCache) {
+    //template snapshots are released by garbage messages independently of
+    //the message, so records refer to shared copies instead
+    const ipx_msg_ctx *ctx = ipx_msg_ipfix_get_ctx(msg);
+    const fds_template *lastTmplt = nullptr;
+    recordTemplates.reserve(records.size());
+    for (fds_drec &rec : records) {
+        if (rec.tmplt != lastTmplt) {
+            lastTmplt = rec.tmplt;
+            templates.push_back(templateCache.get(ctx, &rec));
+        }
+        rec.tmplt = templates.back()->tmplt;
+        recordTemplates.push_back(templates.back().get());
+        if (rec.tmplt->flags & FDS_TEMPLATE_STRUCT) {
+            structured = true;
+        } else {
+            rec.snap = nullptr;
+        }
+    }
+}
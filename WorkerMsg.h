@@ -0,0 +1,85 @@
+#ifndef WORKER_MSG_H
+#define WORKER_MSG_H
+
+#include <ipfixcol2.h>
+#include <memory>
+#include <vector>
+#include "TemplateCache.h"
+
+/**
+ * Wraper for IPFIX message and iemgr
+ *
+ * Records of the message are either borrowed from the original IPFIX message
+ * (zero-copy, the message is kept alive by an extra reference until the
+ * wrapper is destroyed) or deep-copied (fallback).
+ */
+class WorkerMsg final {
+public:
+    const fds_iemgr_t *iemgr;
+    /** observation domain ID of the message                                */
+    uint32_t odid;
+    /** records for conversion (templates point to shared templates)        */
+    std::vector<fds_drec> records;
+    /** shared templates of records (in the same order as records)          */
+    std::vector<const SharedTemplate *> recordTemplates;
+    /** records with structured fields (lists) refer to the template
+     *  snapshot, which is valid only until ipx_plugin_process returns      */
+    bool structured;
+
+    /**
+     * \brief Constructor
+     *
+     * @param[in] ipfix_msg IPFIX message from the pipeline
+     * @param[in] iemgr Information element manager
+     * @param[in] templateCache cache of shared templates
+     * @param[in] zeroCopy borrow the message instead of copying its records
+     */
+    WorkerMsg(ipx_msg_ipfix_t *ipfix_msg, const fds_iemgr_t *iemgr,
+              TemplateCache &templateCache, bool zeroCopy);
+
+    WorkerMsg(const WorkerMsg &) = delete;
+
+    WorkerMsg &operator=(const WorkerMsg &) = delete;
+
+    /**
+     * \brief Destructor
+     * Release borrowed message or free copied records
+     */
+    ~WorkerMsg();
+
+private:
+    //borrowed message (zero-copy only), otherwise nullptr
+    ipx_msg_ipfix_t *ipfix_msg;
+    //shared templates used by records
+    std::vector<std::shared_ptr<const SharedTemplate>> templates;
+    //single block with data of all copied records, otherwise nullptr
+    uint8_t *arena;
+
+    /**
+     * Keep the message alive and reference its records
+     * @param[in] msg IPFIX message
+     */
+    void borrow(ipx_msg_ipfix_t *msg);
+
+    /**
+     * Deep copy of all records of the message
+     *
+     * Data of all records are laid out one after another in the arena, so
+     * the copy costs one allocation per message.
+     * @param[in] msg IPFIX message
+     */
+    void copy(ipx_msg_ipfix_t *msg);
+
+    /**
+     * Replace templates of records by shared templates
+     *
+     * Snapshot of the pipeline is kept only in records of templates with
+     * structured fields (subTemplateList needs it for decoding), the other
+     * records do not refer to it.
+     * @param[in] msg IPFIX message
+     * @param[in] templateCache cache of shared templates
+     */
+    void shareTemplates(ipx_msg_ipfix_t *msg, TemplateCache &templateCache);
+};
+
+#endif // WORKER_MSG_H
@@ -0,0 +1,222 @@
+#include "ZstdCompressor.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+
+namespace {
+
+//capacity of trained dictionary (default of the zstd command line tool)
+constexpr size_t DICTIONARY_CAPACITY = 112640;
+//samples for training, zstd recommends about 100 times the dictionary
+constexpr size_t MAX_SAMPLES_SIZE = 100 * DICTIONARY_CAPACITY;
+
+} // namespace
+
+CompressionContext::CompressionContext() {
+    cctx = nullptr;
+}
+
+CompressionContext::~CompressionContext() {
+    ZSTD_freeCCtx(cctx);
+}
+
+ZstdCompressor::ZstdCompressor(std::shared_ptr<BufferPool> bufferPool,
+                               int level, std::string dictionaryPath,
+                               uint32_t trainSamples) {
+    this->bufferPool = bufferPool;
+    this->level = std::max(ZSTD_minCLevel(),
+                           std::min(level, ZSTD_maxCLevel()));
+    this->dictionaryPath = dictionaryPath;
+    this->trainSamples = trainSamples;
+    dictionary = nullptr;
+    dictionaryId = 0;
+
+    //trained dictionary is useless for consumers without the file
+    sampling = !load() && trainSamples > 0 && !this->dictionaryPath.empty();
+}
+
+ZstdCompressor::~ZstdCompressor() {
+    if (trainThread.joinable()) {
+        trainThread.join();
+    }
+    ZSTD_freeCDict(const_cast<ZSTD_CDict *>(dictionary.load()));
+}
+
+bool ZstdCompressor::load() {
+    if (dictionaryPath.empty()) {
+        return false;
+    }
+    std::ifstream file(dictionaryPath, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    const std::string content((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    if (content.empty()) {
+        return false;
+    }
+    setDictionary(content.data(), content.size());
+    if (dictionary.load() == nullptr) {
+        return false;
+    }
+    Logger::logInfo("Zstd dictionary " + std::to_string(dictionaryId) +
+                    " loaded from " + dictionaryPath);
+    return true;
+}
+
+void ZstdCompressor::setDictionary(const void *data, size_t size) {
+    ZSTD_CDict *cdict = ZSTD_createCDict(data, size, level);
+    if (cdict == nullptr) {
+        Logger::logError("Failed to create zstd dictionary");
+        return;
+    }
+    dictionaryId = ZSTD_getDictID_fromDict(data, size);
+    dictionary.store(cdict, std::memory_order_release);
+}
+
+void ZstdCompressor::sample(const OutputBuffer *buffer) {
+    if (!sampling.load(std::memory_order_relaxed)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(samplesMtx);
+    if (!sampling) {
+        return;
+    }
+    samples.insert(samples.end(), buffer->data,
+                   buffer->data + buffer->length);
+    sampleSizes.push_back(buffer->length);
+    if (sampleSizes.size() < trainSamples &&
+        samples.size() < MAX_SAMPLES_SIZE) {
+        return;
+    }
+
+    //training takes seconds, conversion threads do not wait for it
+    sampling = false;
+    trainThread = std::thread(&ZstdCompressor::train, this,
+                              std::move(samples), std::move(sampleSizes));
+}
+
+void ZstdCompressor::train(std::vector<char> content,
+                           std::vector<size_t> sizes) {
+    std::vector<char> trained(DICTIONARY_CAPACITY);
+    const size_t size = ZDICT_trainFromBuffer(trained.data(), trained.size(),
+                                              content.data(), sizes.data(),
+                                              sizes.size());
+    content = std::vector<char>();
+    if (ZDICT_isError(size)) {
+        Logger::logWarning(std::string("Zstd dictionary is not trained: ") +
+                           ZDICT_getErrorName(size) +
+                           ", messages are compressed without dictionary");
+        return;
+    }
+
+    //consumers need the dictionary before the first message compressed by it
+    const std::string tmp = dictionaryPath + ".tmp" +
+                            std::to_string(getpid());
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        file.write(trained.data(), size);
+        if (!file.flush()) {
+            remove(tmp.c_str());
+            Logger::logError("Failed to write zstd dictionary " + tmp +
+                             ", messages are compressed without dictionary");
+            return;
+        }
+    }
+    if (rename(tmp.c_str(), dictionaryPath.c_str()) != 0) {
+        remove(tmp.c_str());
+        Logger::logError("Failed to write zstd dictionary " +
+                         dictionaryPath +
+                         ", messages are compressed without dictionary");
+        return;
+    }
+
+    setDictionary(trained.data(), size);
+    Logger::logInfo("Zstd dictionary " + std::to_string(dictionaryId) +
+                    " trained from " + std::to_string(sizes.size()) +
+                    " messages and written to " + dictionaryPath);
+}
+
+OutputBuffer *ZstdCompressor::compress(OutputBuffer *buffer,
+                                       CompressionContext *context) {
+    sample(buffer);
+    if (context->cctx == nullptr) {
+        context->cctx = ZSTD_createCCtx();
+        if (context->cctx == nullptr) {
+            return buffer;
+        }
+    }
+
+    OutputBuffer *compressed = bufferPool->acquire();
+    if (!compressed->reserve(ZSTD_compressBound(buffer->length))) {
+        bufferPool->release(compressed);
+        return buffer;
+    }
+
+    const ZSTD_CDict *cdict = dictionary.load(std::memory_order_acquire);
+    size_t rc;
+    if (cdict != nullptr) {
+        rc = ZSTD_compress_usingCDict(context->cctx, compressed->data,
+                                      compressed->size, buffer->data,
+                                      buffer->length, cdict);
+    } else {
+        rc = ZSTD_compressCCtx(context->cctx, compressed->data,
+                               compressed->size, buffer->data,
+                               buffer->length, level);
+    }
+    if (ZSTD_isError(rc)) {
+        Logger::logError(std::string("Zstd compression failed: ") +
+                         ZSTD_getErrorName(rc));
+        bufferPool->release(compressed);
+        return buffer;
+    }
+
+    compressed->length = rc;
+    compressed->compressed = true;
+    compressed->dictionaryId = cdict != nullptr ? dictionaryId.load() : 0;
+    compressed->key.swap(buffer->key);
+    compressed->topic = buffer->topic;
+    bufferPool->release(buffer);
+    return compressed;
+}
+
+#else
+
+//built without zstd, compression is rejected by the configuration
+
+CompressionContext::CompressionContext() {
+    cctx = nullptr;
+}
+
+CompressionContext::~CompressionContext() {
+}
+
+ZstdCompressor::ZstdCompressor(std::shared_ptr<BufferPool> bufferPool,
+                               int level, std::string dictionaryPath,
+                               uint32_t trainSamples) {
+    this->bufferPool = bufferPool;
+    this->level = level;
+    this->dictionaryPath = dictionaryPath;
+    this->trainSamples = trainSamples;
+    dictionary = nullptr;
+    dictionaryId = 0;
+    sampling = false;
+}
+
+ZstdCompressor::~ZstdCompressor() {
+}
+
+OutputBuffer *ZstdCompressor::compress(OutputBuffer *buffer,
+                                       CompressionContext *context) {
+    (void) context;
+    return buffer;
+}
+
+#endif // HAVE_ZSTD
@@ -0,0 +1,126 @@
+#ifndef ZSTD_COMPRESSOR_H
+#define ZSTD_COMPRESSOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BufferPool.h"
+
+//types of zstd (zstd.h), the header is needed only by the implementation
+struct ZSTD_CCtx_s;
+struct ZSTD_CDict_s;
+
+/**
+ * \brief Per-thread compression context
+ */
+class CompressionContext final {
+public:
+    /** zstd context, created on the first compressed message              */
+    ZSTD_CCtx_s *cctx;
+
+    CompressionContext();
+
+    CompressionContext(const CompressionContext &) = delete;
+
+    CompressionContext &operator=(const CompressionContext &) = delete;
+
+    ~CompressionContext();
+};
+
+/**
+ * \brief Compression of kafka messages by zstd with a dictionary
+ *
+ * Messages are compressed by conversion threads before they are handed over
+ * to the producer. The dictionary is loaded from a file, or trained from the
+ * first messages of the plugin by a background thread (until then messages
+ * are compressed without dictionary), written to the file and only then used.
+ * Compressed buffers carry the dictionary ID, which the producer sends in a
+ * header.
+ */
+class ZstdCompressor final {
+private:
+    std::shared_ptr<BufferPool> bufferPool;
+    int level;
+    //file of dictionary, empty if not used
+    std::string dictionaryPath;
+    //messages sampled for training
+    uint32_t trainSamples;
+
+    //dictionary, nullptr until it is loaded or trained (never replaced)
+    std::atomic<const ZSTD_CDict_s *> dictionary;
+    std::atomic_uint32_t dictionaryId;
+
+    //samples for training, guarded by mutex
+    std::atomic_bool sampling;
+    std::mutex samplesMtx;
+    std::vector<char> samples;
+    std::vector<size_t> sampleSizes;
+    //training, started when samples are collected
+    std::thread trainThread;
+
+    /**
+     * Load dictionary from file
+     * @return false if the file does not exist or it is not readable
+     */
+    bool load();
+
+    /**
+     * Add message to samples, start training when there is enough of them
+     * @param[in] buffer uncompressed message
+     */
+    void sample(const OutputBuffer *buffer);
+
+    /**
+     * Train dictionary from samples, write it to the file and use it
+     * (training thread)
+     * @param[in] content concatenated messages
+     * @param[in] sizes sizes of messages
+     */
+    void train(std::vector<char> content, std::vector<size_t> sizes);
+
+    /**
+     * Create dictionary for compression
+     * @param[in] data content of dictionary
+     * @param[in] size size of dictionary
+     */
+    void setDictionary(const void *data, size_t size);
+
+public:
+    /**
+     * \brief Constructor
+     *
+     * @param[in] bufferPool pool of output buffers
+     * @param[in] level compression level
+     * @param[in] dictionaryPath file of dictionary (empty - no file)
+     * @param[in] trainSamples messages sampled for training (0 - only load),
+     *            requires the file
+     */
+    ZstdCompressor(std::shared_ptr<BufferPool> bufferPool, int level,
+                   std::string dictionaryPath, uint32_t trainSamples);
+
+    ZstdCompressor(const ZstdCompressor &) = delete;
+
+    ZstdCompressor &operator=(const ZstdCompressor &) = delete;
+
+    /**
+     * \brief Destructor
+     */
+    ~ZstdCompressor();
+
+    /**
+     * \brief Compress message
+     *
+     * The message buffer is returned to the pool and compressed data are
+     * placed in a new one. On failure, the message is returned uncompressed.
+     * @param[in] buffer message
+     * @param[in,out] context context of the calling thread
+     * @return buffer with compressed message
+     */
+    OutputBuffer *compress(OutputBuffer *buffer, CompressionContext *context);
+};
+
+#endif // ZSTD_COMPRESSOR_H
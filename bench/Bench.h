@@ -0,0 +1,65 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Helpers of benchmarks of the plugin
+ *
+ * Benchmarks are registered by static Registration objects in their files
+ * and run by json-to-kafka-bench (all of them, or the ones named on the
+ * command line). Results are printed one line per measured variant.
+ */
+namespace Bench {
+
+/** Body of benchmark, returns exit code */
+typedef int (*Function)();
+
+/** Registration of benchmark, defined as static object */
+struct Registration {
+    Registration(const char *name, const char *description,
+                 Function function);
+};
+
+/**
+ * \brief Numbers of threads of scaling benchmarks
+ * @return 1, 2, 4, ... up to hardware threads (at least 1)
+ */
+std::vector<uint32_t> threadCounts();
+
+/**
+ * \brief Print result of variant
+ * @param[in] name name of variant
+ * @param[in] items number of processed items (records, messages, ...)
+ * @param[in] seconds duration of the run
+ * @param[in] note additional column (e.g. bytes per record)
+ */
+void report(const std::string &name, uint64_t items, double seconds,
+            const std::string &note = "");
+
+/**
+ * \brief Duration of function in seconds
+ */
+template<typename F>
+double measure(F &&function) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+/**
+ * \brief Keep computed value, so the compiler does not remove the work
+ */
+template<typename T>
+inline void keep(const T &value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+} // namespace Bench
+
+#endif // BENCH_H
@@ -0,0 +1,70 @@
+#include "Bench.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "Logger.h"
+INITIALIZE_EASYLOGGINGPP
+
+namespace {
+
+struct Entry {
+    const char *name;
+    const char *description;
+    Bench::Function function;
+};
+
+//registered benchmarks, filled before main
+std::vector<Entry> &registry() {
+    static std::vector<Entry> entries;
+    return entries;
+}
+
+} // namespace
+
+Bench::Registration::Registration(const char *name, const char *description,
+                                  Function function) {
+    registry().push_back({name, description, function});
+}
+
+std::vector<uint32_t> Bench::threadCounts() {
+    const uint32_t hardware = std::max(std::thread::hardware_concurrency(),
+                                       1U);
+    std::vector<uint32_t> counts;
+    for (uint32_t count = 1; count < hardware; count *= 2) {
+        counts.push_back(count);
+    }
+    counts.push_back(hardware);
+    return counts;
+}
+
+void Bench::report(const std::string &name, uint64_t items, double seconds,
+                   const std::string &note) {
+    printf("%-44s %14.0f /s %10.1f ns %s\n", name.c_str(), items / seconds,
+           seconds * 1e9 / items, note.c_str());
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--list") == 0) {
+        for (const Entry &entry : registry()) {
+            printf("%-16s %s\n", entry.name, entry.description);
+        }
+        return 0;
+    }
+
+    int rc = 0;
+    for (const Entry &entry : registry()) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; i++) {
+            selected = selected || strcmp(argv[i], entry.name) == 0;
+        }
+        if (!selected) {
+            continue;
+        }
+        printf("== %s: %s\n", entry.name, entry.description);
+        rc |= entry.function();
+    }
+    return rc;
+}
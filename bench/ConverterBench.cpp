@@ -0,0 +1,193 @@
+#include "Bench.h"
+#include "BufferPool.h"
+#include "JsonConverter.h"
+#include "PackedConverter.h"
+#include "Records.h"
+#include <cstdio>
+#include <random>
+
+namespace {
+
+using Records::Field;
+using Records::Record;
+
+//records per template
+constexpr size_t RECORDS = 4096;
+constexpr uint64_t ROUNDS = 64;
+
+struct Workload {
+    const char *name;
+    std::vector<Field> fields;
+    std::vector<Record> records;
+};
+
+std::vector<Workload> workloads() {
+    std::mt19937_64 random(42);
+    std::vector<Workload> all;
+
+    //IPv4 flow of a typical exporter
+    Workload flow = {"ipv4 flow", {
+            {0, 8, 4},     //sourceIPv4Address
+            {0, 12, 4},    //destinationIPv4Address
+            {0, 7, 2},     //sourceTransportPort
+            {0, 11, 2},    //destinationTransportPort
+            {0, 4, 1},     //protocolIdentifier
+            {0, 6, 1},     //tcpControlBits (reduced size)
+            {0, 1, 8},     //octetDeltaCount
+            {0, 2, 8},     //packetDeltaCount
+            {0, 152, 8},   //flowStartMilliseconds
+            {0, 153, 8},   //flowEndMilliseconds
+            {0, 10, 4},    //ingressInterface
+            {0, 14, 4},    //egressInterface
+    }, {}};
+    const uint8_t protocols[] = {6, 6, 6, 17, 17, 1};
+    for (size_t i = 0; i < RECORDS; i++) {
+        const uint64_t start = 1527775898000ULL + i * 3;
+        flow.records.push_back(Record()
+                .number(0xc0a80000 + random() % 65536, 4)
+                .number(0x0a000000 + random() % 16777216, 4)
+                .number(random() % 65536, 2).number(443, 2)
+                .number(protocols[i % 6], 1).number(0x1b, 1)
+                .number(random() % 1000000, 8).number(random() % 1000, 8)
+                .number(start, 8).number(start + random() % 60000, 8)
+                .number(1, 4).number(2, 4));
+    }
+    all.push_back(flow);
+
+    //timestamps of flow, export and observation
+    Workload timestamps = {"timestamps", {
+            {0, 150, 4},   //flowStartSeconds
+            {0, 151, 4},   //flowEndSeconds
+            {0, 152, 8},   //flowStartMilliseconds
+            {0, 153, 8},   //flowEndMilliseconds
+            {0, 322, 4},   //observationTimeSeconds
+            {0, 323, 8},   //observationTimeMilliseconds
+            {0, 258, 8},   //collectionTimeMilliseconds
+            {0, 1, 8},     //octetDeltaCount
+    }, {}};
+    for (size_t i = 0; i < RECORDS; i++) {
+        const uint64_t start = 1527775898000ULL + i * 3;
+        const uint64_t end = start + random() % 60000;
+        timestamps.records.push_back(Record()
+                .number(start / 1000, 4).number(end / 1000, 4)
+                .number(start, 8).number(end, 8)
+                .number(end / 1000 + 1, 4).number(end + 1000, 8)
+                .number(end + 1500, 8).number(random() % 1000000, 8));
+    }
+    all.push_back(timestamps);
+
+    //variable-length strings (interface and application names)
+    Workload dynamic = {"strings", {
+            {0, 8, 4},                       //sourceIPv4Address
+            {0, 12, 4},                      //destinationIPv4Address
+            {0, 82, FDS_IPFIX_VAR_IE_LEN},   //interfaceName
+            {0, 96, FDS_IPFIX_VAR_IE_LEN},   //applicationName
+            {0, 1, 8},                       //octetDeltaCount
+            {0, 152, 8},                     //flowStartMilliseconds
+    }, {}};
+    const char *applications[] = {"http", "dns", "tls/1.3",
+                                  "video streaming (\"hd\")"};
+    for (size_t i = 0; i < RECORDS; i++) {
+        dynamic.records.push_back(Record()
+                .number(0xc0a80000 + random() % 65536, 4)
+                .number(0x0a000000 + random() % 16777216, 4)
+                .var("GigabitEthernet0/0/" + std::to_string(i % 48))
+                .var(applications[i % 4])
+                .number(random() % 1000000, 8)
+                .number(1527775898000ULL + i * 3, 8));
+    }
+    all.push_back(dynamic);
+    return all;
+}
+
+//default formatting parameters of the plugin
+std::shared_ptr<ConfigFormat> defaultFormat() {
+    std::shared_ptr<ConfigFormat> format = std::make_shared<ConfigFormat>();
+    format->proto = true;
+    format->tcp_flags = true;
+    format->timestamp = true;
+    format->white_spaces = true;
+    format->ignore_unknown = true;
+    format->ignore_options = true;
+    format->octets_as_uint = true;
+    format->projection = FIELDS_ALL;
+    format->output = OUTPUT_JSON;
+    return format;
+}
+
+/**
+ * Convert records of the workload by the converter into one buffer per
+ * record, as conversion threads do without batching
+ */
+int run(const std::string &name, const RecordConverter &converter,
+        Workload &workload) {
+    //plans are kept in templates, each converter has its own
+    std::shared_ptr<SharedTemplate> shared =
+            Records::makeTemplate(256, workload.fields);
+    if (shared == nullptr) {
+        printf("%s: template not parsed\n", name.c_str());
+        return 1;
+    }
+    std::vector<fds_drec> recs;
+    for (Record &record : workload.records) {
+        recs.push_back(record.drec(shared.get()));
+    }
+
+    BufferPool pool(16, 4096, 0);
+    ConverterState state;
+    uint64_t bytes = 0;
+    int rc = 0;
+    const double seconds = Bench::measure([&] {
+        for (uint64_t round = 0; round < ROUNDS; round++) {
+            for (fds_drec &rec : recs) {
+                OutputBuffer *buffer = pool.acquire();
+                const int length = converter.convert(
+                        shared.get(), &rec, Records::iemgr(), buffer,
+                        &state);
+                rc |= length < 0;
+                bytes += buffer->length;
+                pool.release(buffer);
+            }
+        }
+    });
+    const uint64_t records = ROUNDS * recs.size();
+    char note[32];
+    snprintf(note, sizeof(note), "%.1f B/record", double(bytes) / records);
+    Bench::report(name + " " + workload.name, records, seconds, note);
+    return rc;
+}
+
+int converterBench() {
+    if (Records::iemgr() == nullptr) {
+        return 1;
+    }
+    std::shared_ptr<ConfigFormat> format = defaultFormat();
+    std::shared_ptr<ConfigProcessing> compiled =
+            std::make_shared<ConfigProcessing>();
+    compiled->compiledConversion = true;
+    compiled->verifyConversion = 0;
+    std::shared_ptr<ConfigProcessing> generic =
+            std::make_shared<ConfigProcessing>();
+    generic->compiledConversion = false;
+
+    const JsonConverter plans(format, compiled);
+    const JsonConverter libfds(format, generic);
+    //binary formats against JSON of the same records
+    const PackedConverter msgpack(format, false);
+    const PackedConverter cbor(format, true);
+
+    int rc = 0;
+    for (Workload &workload : workloads()) {
+        rc |= run("json fds_drec2json", libfds, workload);
+        rc |= run("json plan", plans, workload);
+        rc |= run("msgpack", msgpack, workload);
+        rc |= run("cbor", cbor, workload);
+    }
+    return rc;
+}
+
+const Bench::Registration registration(
+        "converter", "conversion of records (records/s, bytes/record)",
+        converterBench);
+
+} // namespace
@@ -0,0 +1,126 @@
+#include "Bench.h"
+#include "NumberFormat.h"
+#include <ipfixcol2.h>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+//fields per variant
+constexpr size_t FIELDS = 1 << 16;
+constexpr uint64_t ROUNDS = 64;
+
+struct Field {
+    uint8_t data[8];
+    uint8_t size;
+};
+
+/**
+ * Fields of random values, sizes of counters and identifiers (1 - 8 bytes)
+ * with values of all lengths of digits
+ */
+std::vector<Field> integers() {
+    std::mt19937_64 random(42);
+    std::vector<Field> fields(FIELDS);
+    const uint8_t sizes[] = {1, 2, 4, 8};
+    for (Field &field : fields) {
+        field.size = sizes[random() % 4];
+        uint64_t value = random() >> (random() % 64);
+        for (size_t i = field.size; i > 0; i--) {
+            field.data[i - 1] = uint8_t(value);
+            value >>= 8;
+        }
+    }
+    return fields;
+}
+
+std::vector<Field> floats() {
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> mantissa(-1.0, 1.0);
+    std::vector<Field> fields(FIELDS);
+    for (size_t n = 0; n < fields.size(); n++) {
+        Field &field = fields[n];
+        //magnitudes 1e-10 - 1e10
+        const double value = mantissa(random) *
+                             std::pow(10.0, int(n % 21) - 10);
+        uint64_t bits;
+        if (n % 2 == 0) {
+            field.size = 4;
+            const float single = float(value);
+            uint32_t singleBits;
+            memcpy(&singleBits, &single, 4);
+            bits = singleBits;
+        } else {
+            field.size = 8;
+            memcpy(&bits, &value, 8);
+        }
+        for (size_t i = field.size; i > 0; i--) {
+            field.data[i - 1] = uint8_t(bits);
+            bits >>= 8;
+        }
+    }
+    return fields;
+}
+
+template<typename Format>
+int run(const std::string &name, const std::vector<Field> &fields,
+        Format format) {
+    char out[64];
+    uint64_t length = 0;
+    const double seconds = Bench::measure([&] {
+        for (uint64_t round = 0; round < ROUNDS; round++) {
+            for (const Field &field : fields) {
+                const int rc = format(field.data, field.size, out,
+                                      sizeof(out));
+                Bench::keep(out);
+                length += rc;
+            }
+        }
+    });
+    char note[32];
+    snprintf(note, sizeof(note), "%.1f chars/value",
+             double(length) / ROUNDS / fields.size());
+    Bench::report(name, ROUNDS * fields.size(), seconds, note);
+    return 0;
+}
+
+int numberFormatBench() {
+    const std::vector<Field> ints = integers();
+    run("uint NumberFormat", ints,
+        [](const uint8_t *data, size_t size, char *out, size_t) {
+            return int(NumberFormat::writeUint(
+                    NumberFormat::readUintBe(data, size), out) - out);
+        });
+    run("uint fds_uint2str_be", ints, fds_uint2str_be);
+    run("uint snprintf", ints,
+        [](const uint8_t *data, size_t size, char *out, size_t outSize) {
+            return snprintf(out, outSize, "%" PRIu64,
+                            NumberFormat::readUintBe(data, size));
+        });
+
+    run("int NumberFormat", ints,
+        [](const uint8_t *data, size_t size, char *out, size_t) {
+            return int(NumberFormat::writeInt(
+                    NumberFormat::readIntBe(data, size), out) - out);
+        });
+    run("int fds_int2str_be", ints, fds_int2str_be);
+    run("int snprintf", ints,
+        [](const uint8_t *data, size_t size, char *out, size_t outSize) {
+            return snprintf(out, outSize, "%" PRId64,
+                            NumberFormat::readIntBe(data, size));
+        });
+
+    const std::vector<Field> reals = floats();
+    run("float NumberFormat", reals, NumberFormat::writeFloatBe);
+    run("float fds_float2str_be", reals, fds_float2str_be);
+    return 0;
+}
+
+const Bench::Registration registration(
+        "number", "formatting of numeric fields (values/s)",
+        numberFormatBench);
+
+} // namespace
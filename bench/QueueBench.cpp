@@ -0,0 +1,125 @@
+#include "Bench.h"
+#include "MpmcQueue.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+//transfers per run
+constexpr uint64_t ITEMS = 1 << 21;
+//capacity of queues (default messagesBufferSize)
+constexpr size_t CAPACITY = 1024;
+
+/**
+ * Ring guarded by one mutex (input buffer of the plugin before the
+ * lock-free queue)
+ */
+template<typename T>
+class LockedRing final {
+private:
+    std::mutex mtx;
+    std::vector<T> cells;
+    size_t head = 0;
+    size_t count = 0;
+
+public:
+    explicit LockedRing(size_t capacity) : cells(capacity) {
+    }
+
+    bool tryPush(T &value) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (count == cells.size()) {
+            return false;
+        }
+        cells[(head + count++) % cells.size()] = std::move(value);
+        return true;
+    }
+
+    bool tryPop(T &value) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (count == 0) {
+            return false;
+        }
+        value = std::move(cells[head]);
+        head = (head + 1) % cells.size();
+        count--;
+        return true;
+    }
+};
+
+/**
+ * Move ITEMS values through the queue from producers to consumers
+ * @return checksum of consumed values
+ */
+template<typename Queue>
+uint64_t transfer(Queue &queue, uint32_t producers, uint32_t consumers) {
+    std::atomic_uint64_t consumed(0);
+    std::atomic_uint64_t checksum(0);
+    std::vector<std::thread> threads;
+    for (uint32_t p = 0; p < producers; p++) {
+        threads.emplace_back([&queue, p, producers] {
+            for (uint64_t i = p; i < ITEMS; i += producers) {
+                uint64_t value = i;
+                while (!queue.tryPush(value)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (uint32_t c = 0; c < consumers; c++) {
+        threads.emplace_back([&queue, &consumed, &checksum] {
+            uint64_t sum = 0;
+            uint64_t value;
+            while (consumed.load(std::memory_order_relaxed) < ITEMS) {
+                if (queue.tryPop(value)) {
+                    sum += value;
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            checksum += sum;
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return checksum;
+}
+
+template<typename Queue>
+int run(const char *name, uint32_t producers, uint32_t consumers) {
+    Queue queue(CAPACITY);
+    uint64_t checksum = 0;
+    const double seconds = Bench::measure([&] {
+        checksum = transfer(queue, producers, consumers);
+    });
+    if (checksum != ITEMS * (ITEMS - 1) / 2) {
+        printf("%s: lost values\n", name);
+        return 1;
+    }
+    Bench::report(std::string(name) + " " + std::to_string(producers) +
+                  "p/" + std::to_string(consumers) + "c", ITEMS, seconds);
+    return 0;
+}
+
+//one producer (ipx_plugin_process) and N conversion threads, then N to N
+int queueBench() {
+    int rc = 0;
+    for (uint32_t threads : Bench::threadCounts()) {
+        rc |= run<LockedRing<uint64_t>>("locked ring", 1, threads);
+        rc |= run<MpmcQueue<uint64_t>>("mpmc queue", 1, threads);
+    }
+    for (uint32_t threads : Bench::threadCounts()) {
+        rc |= run<LockedRing<uint64_t>>("locked ring", threads, threads);
+        rc |= run<MpmcQueue<uint64_t>>("mpmc queue", threads, threads);
+    }
+    return rc;
+}
+
+const Bench::Registration registration(
+        "queue", "input buffer under contention (transfers/s)", queueBench);
+
+} // namespace
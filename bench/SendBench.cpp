@@ -0,0 +1,316 @@
+#include "Bench.h"
+#include "BufferPool.h"
+#include "KafkaProducer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Properties = std::vector<std::pair<std::string, std::string>>;
+
+//records per throughput run
+constexpr uint64_t RECORDS = 500000;
+//records of latency runs, generated at constant rate
+constexpr uint64_t LATENCY_RATE = 20000;
+constexpr uint64_t LATENCY_RECORDS = 3 * LATENCY_RATE;
+//limit of waiting for delivery reports
+constexpr auto DELIVERY_TIMEOUT = std::chrono::seconds(60);
+
+//record of the default JSON output
+const char RECORD[] =
+        "{\"@type\":\"ipfix.entry\",\"iana:octetDeltaCount\":1420,"
+        "\"iana:packetDeltaCount\":3,\"iana:protocolIdentifier\":\"TCP\","
+        "\"iana:sourceTransportPort\":44211,"
+        "\"iana:destinationTransportPort\":443,"
+        "\"iana:sourceIPv4Address\":\"192.168.0.12\","
+        "\"iana:destinationIPv4Address\":\"10.10.0.1\","
+        "\"iana:flowStartMilliseconds\":\"2018-05-31T14:11:38.123Z\","
+        "\"iana:flowEndMilliseconds\":\"2018-05-31T14:11:39.456Z\"}";
+
+/**
+ * Properties of librdkafka (<property>) and batching of the plugin
+ * (<batchMaxRecords>, <batchLingerMs>) of a tuning profile
+ */
+struct Profile {
+    const char *name;
+    Properties properties;
+    uint32_t batchMaxRecords;
+    uint32_t batchLingerMs;
+};
+
+//profiles of README (Tuning profiles), defaults of the plugin first
+std::vector<Profile> profiles() {
+    return {
+            {"default", {}, 1, 100},
+            {"low latency", {
+                    {"linger.ms", "0"},
+                    {"acks", "1"},
+            }, 1, 100},
+            {"high throughput", {
+                    {"linger.ms", "50"},
+                    {"batch.size", "1000000"},
+                    {"compression.codec", "lz4"},
+                    {"queue.buffering.max.kbytes", "1048576"},
+                    {"socket.send.buffer.bytes", "1048576"},
+            }, 100, 100},
+            {"durable", {
+                    {"enable.idempotence", "true"},
+                    {"acks", "all"},
+                    {"linger.ms", "20"},
+            }, 1, 100},
+    };
+}
+
+/**
+ * Append record to the buffer, records of batches are newline-delimited
+ * as by conversion threads
+ */
+bool append(OutputBuffer *buffer, bool batching) {
+    if (!buffer->reserve(sizeof(RECORD))) {
+        return false;
+    }
+    memcpy(buffer->data + buffer->length, RECORD, sizeof(RECORD) - 1);
+    buffer->length += sizeof(RECORD) - 1;
+    if (batching) {
+        buffer->data[buffer->length++] = '\n';
+    }
+    return true;
+}
+
+/**
+ * Wait until all sent messages have their delivery report
+ * @return false on timeout
+ */
+bool waitDelivered(const KafkaProducer &producer, uint64_t messages) {
+    const Clock::time_point deadline = Clock::now() + DELIVERY_TIMEOUT;
+    while (producer.getReportedMessages() < messages) {
+        if (Clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+/**
+ * Convert records by N threads into pool buffers (batched by the profile)
+ * and hand them over to one producer, optionally serialized by one mutex
+ * (lckSend of the plugin before concurrent sending). Records/s are counted
+ * until all messages are delivered, hand over is in the note.
+ */
+int throughput(const std::string &broker, const Profile &profile,
+               uint32_t threads, bool locked) {
+    const size_t colon = broker.rfind(':');
+    std::shared_ptr<BufferPool> pool = std::make_shared<BufferPool>(
+            4096, 4096, 0);
+    KafkaProducer producer(broker.substr(0, colon),
+                           broker.substr(colon + 1),
+                           {"json-to-kafka-bench"}, "", profile.properties,
+                           pool);
+    if (!producer.connect()) {
+        printf("failed to connect %s\n", broker.c_str());
+        return 1;
+    }
+
+    const bool batching = profile.batchMaxRecords > 1;
+    std::mutex lckSend;
+    std::atomic_uint64_t messages(0);
+    std::vector<std::thread> workers;
+    double handover = 0;
+    bool delivered = false;
+    const double seconds = Bench::measure([&] {
+        handover = Bench::measure([&] {
+            for (uint32_t t = 0; t < threads; t++) {
+                workers.emplace_back([&, t] {
+                    OutputBuffer *buffer = pool->acquire();
+                    uint32_t records = 0;
+                    for (uint64_t i = t; i < RECORDS; i += threads) {
+                        if (!append(buffer, batching)) {
+                            continue;
+                        }
+                        if (++records < profile.batchMaxRecords &&
+                            i + threads < RECORDS) {
+                            continue;
+                        }
+                        messages++;
+                        if (locked) {
+                            std::lock_guard<std::mutex> lock(lckSend);
+                            producer.sendMessage(buffer);
+                        } else {
+                            producer.sendMessage(buffer);
+                        }
+                        buffer = pool->acquire();
+                        records = 0;
+                    }
+                    pool->release(buffer);
+                });
+            }
+            for (std::thread &worker : workers) {
+                worker.join();
+            }
+        });
+        delivered = waitDelivered(producer, messages);
+    });
+    producer.disconnect();
+    if (!delivered) {
+        printf("%s: messages not delivered\n", profile.name);
+        return 1;
+    }
+
+    char note[64];
+    snprintf(note, sizeof(note), "hand over %.0f /s", RECORDS / handover);
+    Bench::report(std::string(profile.name) +
+                  (locked ? " lckSend mutex " : " concurrent ") +
+                  std::to_string(threads) + " threads", RECORDS, seconds,
+                  note);
+    return 0;
+}
+
+/**
+ * Records generated at constant rate by one thread, batched by the profile
+ * (batchMaxRecords, batchLingerMs); latency of a message is measured from
+ * its first record to its delivery report. Messages are matched with
+ * delivery reports in order of sending, which is exact for a topic with
+ * one partition.
+ */
+int latency(const std::string &broker, const Profile &profile) {
+    const size_t colon = broker.rfind(':');
+    std::shared_ptr<BufferPool> pool = std::make_shared<BufferPool>(
+            4096, 4096, 0);
+    KafkaProducer producer(broker.substr(0, colon),
+                           broker.substr(colon + 1),
+                           {"json-to-kafka-bench"}, "", profile.properties,
+                           pool);
+    if (!producer.connect()) {
+        printf("failed to connect %s\n", broker.c_str());
+        return 1;
+    }
+
+    //time of the first record of each sent message
+    std::vector<Clock::time_point> firstRecords(LATENCY_RECORDS);
+    std::vector<double> latencies(LATENCY_RECORDS);
+    std::atomic_uint64_t messages(0);
+    std::atomic_bool generating(true);
+    std::thread reports([&] {
+        uint64_t reported = 0;
+        //last pass after the sender stops waiting for delivery reports
+        bool last = false;
+        while (!last) {
+            last = !generating;
+            const uint64_t now = std::min<uint64_t>(
+                    producer.getReportedMessages(), messages);
+            const Clock::time_point time = Clock::now();
+            for (; reported < now; reported++) {
+                const std::chrono::duration<double, std::milli> elapsed =
+                        time - firstRecords[reported];
+                latencies[reported] = elapsed.count();
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+
+    const bool batching = profile.batchMaxRecords > 1;
+    const std::chrono::milliseconds linger(profile.batchLingerMs);
+    OutputBuffer *buffer = pool->acquire();
+    uint32_t records = 0;
+    const auto send = [&] {
+        producer.sendMessage(buffer);
+        messages++;
+        buffer = pool->acquire();
+        records = 0;
+    };
+    const Clock::time_point start = Clock::now();
+    uint64_t generated = 0;
+    while (generated < LATENCY_RECORDS) {
+        //records due by now, then the linger of unfinished batch
+        const Clock::time_point now = Clock::now();
+        const std::chrono::duration<double> elapsed = now - start;
+        const uint64_t due = std::min<uint64_t>(
+                elapsed.count() * LATENCY_RATE, LATENCY_RECORDS);
+        for (; generated < due; generated++) {
+            if (records == 0) {
+                //the record was due, even if the thread slept longer
+                firstRecords[messages] = start +
+                        std::chrono::duration_cast<Clock::duration>(
+                                std::chrono::duration<double>(
+                                        double(generated) / LATENCY_RATE));
+            }
+            append(buffer, batching);
+            if (++records >= profile.batchMaxRecords) {
+                send();
+            }
+        }
+        if (records > 0 && now - firstRecords[messages] >= linger) {
+            send();
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    if (records > 0) {
+        send();
+    }
+    pool->release(buffer);
+    const bool delivered = waitDelivered(producer, messages);
+    generating = false;
+    reports.join();
+    producer.disconnect();
+    if (!delivered) {
+        printf("%s: messages not delivered\n", profile.name);
+        return 1;
+    }
+
+    latencies.resize(messages);
+    std::sort(latencies.begin(), latencies.end());
+    char note[96];
+    snprintf(note, sizeof(note), "%lu msgs, p50 %.1f ms, p99 %.1f ms, "
+             "max %.1f ms", (unsigned long) latencies.size(),
+             latencies[latencies.size() / 2],
+             latencies[latencies.size() * 99 / 100], latencies.back());
+    const std::chrono::duration<double> seconds = Clock::now() - start;
+    Bench::report(std::string(profile.name) + " latency", LATENCY_RECORDS,
+                  seconds.count(), note);
+    return 0;
+}
+
+//broker from JSON_TO_KAFKA_BENCH_BROKER (default localhost:9092)
+std::string broker() {
+    const char *env = getenv("JSON_TO_KAFKA_BENCH_BROKER");
+    return env != nullptr ? env : "localhost:9092";
+}
+
+//sending by threads with and without lckSend, default profile
+int sendBench() {
+    const Profile profile = profiles().front();
+    int rc = 0;
+    for (uint32_t threads : Bench::threadCounts()) {
+        rc |= throughput(broker(), profile, threads, true);
+        rc |= throughput(broker(), profile, threads, false);
+    }
+    return rc;
+}
+
+//throughput (all threads) and latency (constant rate) of tuning profiles
+int profileBench() {
+    const uint32_t threads = Bench::threadCounts().back();
+    int rc = 0;
+    for (const Profile &profile : profiles()) {
+        rc |= throughput(broker(), profile, threads, false);
+        rc |= latency(broker(), profile);
+    }
+    return rc;
+}
+
+const Bench::Registration sendRegistration(
+        "send", "records handed over to the producer (records/s)",
+        sendBench);
+
+const Bench::Registration profileRegistration(
+        "profile", "tuning profiles of README (records/s, latency)",
+        profileBench);
+
+} // namespace
@@ -0,0 +1,80 @@
+#include "Bench.h"
+#include "StringEscape.h"
+#include <cstring>
+
+namespace {
+
+//scans per variant
+constexpr uint64_t SCANS = 20000000;
+
+//byte-wise scan (STRING formatter before the kernels)
+size_t findBytewise(const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        const uint8_t c = data[i];
+        if (c < 0x20 || c >= 0x7F || c == '"' || c == '\\' || c == '/') {
+            return i;
+        }
+    }
+    return size;
+}
+
+/**
+ * Scan the string from start to end, as the STRING formatter does (clean
+ * runs and bytes which need escaping)
+ */
+template<typename Find>
+int run(const std::string &name, const std::string &text, Find find) {
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(text.data());
+    const size_t size = text.size();
+    const uint64_t scans = SCANS / (1 + size / 64);
+    size_t found = 0;
+    const double seconds = Bench::measure([&] {
+        for (uint64_t n = 0; n < scans; n++) {
+            Bench::keep(data);
+            for (size_t i = 0; i < size; i++) {
+                i += find(data + i, size - i);
+                found++;
+            }
+        }
+    });
+    Bench::keep(found);
+    Bench::report(name, scans, seconds,
+                  std::to_string(size) + " B/string");
+    return 0;
+}
+
+int stringEscapeBench() {
+    std::string path;
+    while (path.size() < 200) {
+        path += "/var/lib/collector/exporter";
+    }
+    std::string clean(200, 'a');
+    for (size_t i = 0; i < clean.size(); i++) {
+        clean[i] = char('a' + i % 26);
+    }
+    const struct {
+        const char *name;
+        std::string text;
+    } strings[] = {
+            {"short clean", "eth0"},
+            {"short escaped", "a\"b/c"},
+            {"interface name", "GigabitEthernet0/0/1.100"},
+            {"long clean", clean},
+            {"long escaped", path},
+    };
+
+    const std::string kernel = StringEscape::kernelName();
+    for (const auto &string : strings) {
+        run(std::string(string.name) + " byte-wise", string.text,
+            findBytewise);
+        run(std::string(string.name) + " " + kernel, string.text,
+            StringEscape::find);
+    }
+    return 0;
+}
+
+const Bench::Registration registration(
+        "escape", "scan of string fields for escaping (strings/s)",
+        stringEscapeBench);
+
+} // namespace
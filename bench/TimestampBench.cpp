@@ -0,0 +1,104 @@
+#include "Bench.h"
+#include "TimestampCache.h"
+#include <ipfixcol2.h>
+#include <ctime>
+#include <random>
+#include <vector>
+
+namespace {
+
+//timestamps per pattern
+constexpr size_t TIMESTAMPS = 1 << 16;
+constexpr uint64_t ROUNDS = 32;
+//2018-05-31T14:11:38Z
+constexpr uint64_t BASE_MSEC = 1527775898000ULL;
+
+/**
+ * Timestamps of flow records (milliseconds, big endian)
+ * @param[in] spread range of timestamps in milliseconds
+ */
+std::vector<uint64_t> timestamps(uint64_t spread) {
+    std::mt19937_64 random(42);
+    std::vector<uint64_t> values(TIMESTAMPS);
+    for (uint64_t &value : values) {
+        uint64_t msec = BASE_MSEC + random() % spread;
+        uint8_t *data = reinterpret_cast<uint8_t *>(&value);
+        for (size_t i = 8; i > 0; i--) {
+            data[i - 1] = uint8_t(msec);
+            msec >>= 8;
+        }
+    }
+    return values;
+}
+
+template<typename Format>
+void run(const std::string &name, const std::vector<uint64_t> &values,
+         Format format) {
+    char out[64];
+    uint64_t length = 0;
+    const double seconds = Bench::measure([&] {
+        for (uint64_t round = 0; round < ROUNDS; round++) {
+            for (const uint64_t &value : values) {
+                length += format(reinterpret_cast<const uint8_t *>(&value),
+                                 out, sizeof(out));
+                Bench::keep(out);
+            }
+        }
+    });
+    Bench::keep(length);
+    Bench::report(name, ROUNDS * values.size(), seconds);
+}
+
+//flowStartMilliseconds / flowEndMilliseconds of a template, formatted
+int timestampBench() {
+    const struct {
+        const char *name;
+        uint64_t spread;
+    } patterns[] = {
+            //records of one IPFIX message
+            {"2 s", 2000},
+            //records of active timeout
+            {"5 min", 300000},
+            //every record in another second
+            {"1 day", 86400000},
+    };
+
+    for (const auto &pattern : patterns) {
+        const std::vector<uint64_t> values = timestamps(pattern.spread);
+        TimestampCache cache;
+        run(std::string(pattern.name) + " TimestampCache", values,
+            [&cache](const uint8_t *data, char *out, size_t) {
+                uint64_t msec;
+                fds_get_datetime_lp_be(data, 8, FDS_ET_DATE_TIME_MILLISECONDS,
+                                       &msec);
+                return cache.write(msec, out);
+            });
+        run(std::string(pattern.name) + " fds_datetime2str_be", values,
+            [](const uint8_t *data, char *out, size_t outSize) {
+                return fds_datetime2str_be(data, 8,
+                                           FDS_ET_DATE_TIME_MILLISECONDS,
+                                           out, outSize,
+                                           FDS_CONVERT_TF_MSEC_UTC);
+            });
+        run(std::string(pattern.name) + " gmtime_r + strftime", values,
+            [](const uint8_t *data, char *out, size_t outSize) {
+                uint64_t msec;
+                fds_get_datetime_lp_be(data, 8, FDS_ET_DATE_TIME_MILLISECONDS,
+                                       &msec);
+                const time_t second = msec / 1000;
+                struct tm tm;
+                gmtime_r(&second, &tm);
+                const size_t length = strftime(out, outSize,
+                                               "%Y-%m-%dT%H:%M:%S", &tm);
+                return length + snprintf(out + length, outSize - length,
+                                         ".%03uZ", unsigned(msec % 1000));
+            });
+    }
+    return 0;
+}
+
+const Bench::Registration registration(
+        "timestamp", "formatting of millisecond timestamps (values/s)",
+        timestampBench);
+
+} // namespace
@@ -0,0 +1,429 @@
+#include "Records.h"
+#include "BufferPool.h"
+#include "JsonConverter.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Logger.h"
+INITIALIZE_EASYLOGGINGPP
+
+/*
+ * Equivalence of compiled JSON conversion with fds_drec2json
+ *
+ * Records of synthetic templates are converted by compiled plans (without
+ * runtime cross-check) and by fds_drec2json under every combination of the
+ * formatting parameters, outputs must be identical byte for byte. Records of
+ * covered cases must be converted by the plan itself; records of fallback
+ * cases hold values the plan leaves to fds_drec2json (control and non-ASCII
+ * chars, unnamed protocols, non-finite floats, invalid booleans).
+ */
+
+namespace {
+
+using Records::Field;
+using Records::Record;
+
+//unknown enterprise fields
+constexpr uint32_t EN_UNKNOWN = 8057;
+//seconds between 1900 (NTP) and 1970 (UNIX)
+constexpr uint64_t NTP_EPOCH = 2208988800ULL;
+
+int failures = 0;
+int comparisons = 0;
+
+struct Case {
+    const char *name;
+    std::vector<Field> fields;
+    std::vector<Record> records;
+    //values are left to fds_drec2json (per-record fallback of the plan)
+    bool fallback;
+};
+
+//boolean formatting parameters, one bit of combination each
+enum FormatBit {
+    BIT_TCP_FLAGS,
+    BIT_TIMESTAMP,
+    BIT_PROTO,
+    BIT_IGNORE_UNKNOWN,
+    BIT_WHITE_SPACES,
+    BIT_NUMERIC_NAMES,
+    BIT_OCTETS_AS_UINT,
+    BITS
+};
+
+std::shared_ptr<ConfigFormat> makeFormat(unsigned bits) {
+    std::shared_ptr<ConfigFormat> format = std::make_shared<ConfigFormat>();
+    format->tcp_flags = bits & (1U << BIT_TCP_FLAGS);
+    format->timestamp = bits & (1U << BIT_TIMESTAMP);
+    format->proto = bits & (1U << BIT_PROTO);
+    format->ignore_unknown = bits & (1U << BIT_IGNORE_UNKNOWN);
+    format->white_spaces = bits & (1U << BIT_WHITE_SPACES);
+    format->numeric_names = bits & (1U << BIT_NUMERIC_NAMES);
+    format->octets_as_uint = bits & (1U << BIT_OCTETS_AS_UINT);
+    format->projection = FIELDS_ALL;
+    format->output = OUTPUT_JSON;
+    format->compact = false;
+    return format;
+}
+
+//flags of fds_drec2json documented for the parameters (README)
+uint32_t libfdsFlags(const ConfigFormat &format) {
+    uint32_t flags = FDS_CD2J_ALLOW_REALLOC;
+    flags |= format.tcp_flags ? FDS_CD2J_FORMAT_TCPFLAGS : 0;
+    flags |= format.timestamp ? FDS_CD2J_TS_FORMAT_MSEC : 0;
+    flags |= format.proto ? FDS_CD2J_FORMAT_PROTO : 0;
+    flags |= format.ignore_unknown ? FDS_CD2J_IGNORE_UNKNOWN : 0;
+    flags |= format.white_spaces ? 0 : FDS_CD2J_NON_PRINTABLE;
+    flags |= format.numeric_names ? FDS_CD2J_NUMERIC_ID : 0;
+    flags |= format.octets_as_uint ? 0 : FDS_CD2J_OCTETS_NOINT;
+    return flags;
+}
+
+uint64_t ntp(uint64_t seconds, uint32_t fraction) {
+    return (seconds + NTP_EPOCH) << 32 | fraction;
+}
+
+uint64_t doubleBits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+//strings with chars escaped by the plan, short and long (vector paths)
+std::vector<std::string> strings() {
+    std::string mixed;
+    for (int i = 0; i < 12; i++) {
+        mixed += "path/to\\file \"quoted\" ";
+    }
+    return {
+            "",
+            "eth0",
+            "a/b",
+            "/",
+            "quote\" back\\slash",
+            std::string(31, 'x') + "/" + std::string(31, 'y') + "\"",
+            mixed,
+    };
+}
+
+//strings with chars left to fds_drec2json (control, non-ASCII)
+std::vector<std::string> fallbackStrings() {
+    std::string mixed;
+    for (int i = 0; i < 12; i++) {
+        mixed += "path/to\\file \"quoted\"\t\x01\x7f ";
+    }
+    return {
+            "tab\tnew\nline\rreturn\fform\bback",
+            std::string("\x00\x01\x1f\x7f", 4),
+            "\xc5\xbelu\xc5\xa5ou\xc4\x8dk\xc3\xbd k\xc5\xaf\xc5\x88",
+            "\xff\xfe\xc3 invalid utf-8",
+            mixed,
+    };
+}
+
+std::vector<Case> cases() {
+    std::vector<Case> all;
+
+    Case numbers = {"numbers", {
+            {0, 1, 8},     //octetDeltaCount
+            {0, 2, 4},     //packetDeltaCount (reduced size)
+            {0, 10, 2},    //ingressInterface (reduced size)
+            {0, 311, 8},   //samplingProbability
+            {0, 434, 4},   //mibObjectValueInteger
+            {0, 276, 1},   //dataRecordsReliability
+    }, {}, false};
+    const uint64_t uints[] = {0, 1, 9, 10, 99, 4294967295ULL,
+                              1234567890123ULL, 18446744073709551615ULL};
+    const double doubles[] = {0.0, -0.0, 0.5, 1e-7, 123456.789, 1e300,
+                              -2.5e-300, 3.4028234663852886e38, 1.0 / 3};
+    const double nonFinite[] = {1.0 / 0.0, -1.0 / 0.0, 0.0 / 0.0};
+    const uint32_t ints[] = {0, 1, 0xffffffff, 0x80000000, 0x7fffffff};
+    for (size_t i = 0; i < 9; i++) {
+        Record record;
+        record.number(uints[i % 8], 8).number(uints[(i + 3) % 8], 4)
+                .number(uints[(i + 5) % 8], 2)
+                .number(doubleBits(doubles[i]), 8)
+                .number(ints[i % 5], 4)
+                .number(1 + i % 2, 1); //1 - true, 2 - false
+        numbers.records.push_back(record);
+    }
+    all.push_back(numbers);
+
+    Case floats = {"float32", {
+            {0, 311, 4},   //samplingProbability (reduced size)
+    }, {}, false};
+    for (double value : doubles) {
+        //finite in single precision
+        if (float(value) - float(value) == 0) {
+            floats.records.push_back(Record().number(floatBits(value), 4));
+        }
+    }
+    all.push_back(floats);
+
+    Case flow = {"flow", {
+            {0, 4, 1},     //protocolIdentifier
+            {0, 6, 2},     //tcpControlBits
+            {0, 7, 2},     //sourceTransportPort
+            {0, 8, 4},     //sourceIPv4Address
+            {0, 28, 16},   //destinationIPv6Address
+            {0, 56, 6},    //sourceMacAddress
+            {0, 80, 6},    //destinationMacAddress
+    }, {}, false};
+    const uint8_t protocols[] = {6, 17, 1, 58, 132, 0, 47, 50, 142};
+    const uint16_t tcpFlags[] = {0x02, 0x12, 0x10, 0x3f, 0x1c0, 0xfff, 0,
+                                 0x11, 0x04};
+    for (size_t i = 0; i < 9; i++) {
+        flow.records.push_back(Record()
+                .number(protocols[i], 1).number(tcpFlags[i], 2)
+                .number(i * 7919, 2).number(0xc0a80000 + i, 4)
+                .raw(std::string("\x20\x01\x0d\xb8", 4))
+                .number(0, 8).number(i, 4)
+                .number(0x0000f0e1d2c3ULL + i, 6)
+                .number(0xffffffffffffULL, 6));
+    }
+    all.push_back(flow);
+
+    Case timestamps = {"timestamps", {
+            {0, 150, 4},   //flowStartSeconds
+            {0, 152, 8},   //flowStartMilliseconds
+            {0, 154, 8},   //flowStartMicroseconds
+            {0, 156, 8},   //flowStartNanoseconds
+    }, {}, false};
+    //records of one second (cached formatting), then other seconds
+    const uint64_t seconds[] = {1527775898, 1527775898, 1527775898,
+                                1527775899, 0, 4102444800ULL, 1527775898};
+    for (size_t i = 0; i < 7; i++) {
+        const uint64_t millis = seconds[i] * 1000 + (i * 137) % 1000;
+        timestamps.records.push_back(Record()
+                .number(seconds[i], 4).number(millis, 8)
+                .number(ntp(seconds[i], 0x80000000U + i), 8)
+                .number(ntp(seconds[i], 0x0000ffffU * i), 8));
+    }
+    all.push_back(timestamps);
+
+    Case octets = {"octets", {
+            {0, 70, 3},            //mplsTopLabelStackSection
+            {0, 210, 2},           //paddingOctets (hidden)
+            {EN_UNKNOWN, 1000, 4}, //unknown
+            {EN_UNKNOWN, 1001, 9}, //unknown, too long for integer
+            {0, 83, 8},            //interfaceDescription (fixed size)
+    }, {}, false};
+    for (uint32_t value : ints) {
+        octets.records.push_back(Record()
+                .number(value, 3).number(0, 2).number(value, 4)
+                .raw("\x01\x02\x03\x04\x05\x06\x07\x08\x09")
+                .raw("a/\"b\\xyz"));
+    }
+    all.push_back(octets);
+
+    Case dynamic = {"dynamic", {
+            {0, 1, 8},                                //octetDeltaCount
+            {0, 82, FDS_IPFIX_VAR_IE_LEN},            //interfaceName
+            {0, 8, 4},                                //sourceIPv4Address
+            {0, 96, FDS_IPFIX_VAR_IE_LEN},            //applicationName
+            {EN_UNKNOWN, 1002, FDS_IPFIX_VAR_IE_LEN}, //unknown
+            {0, 152, 8},                              //flowStartMilliseconds
+    }, {}, false};
+    const std::vector<std::string> texts = strings();
+    for (size_t i = 0; i < texts.size(); i++) {
+        dynamic.records.push_back(Record()
+                .number(uints[i % 8], 8).var(texts[i])
+                .number(0x0a000001 + i, 4)
+                .var(texts[texts.size() - 1 - i])
+                .var(std::string(i * 40, char('0' + i)))
+                .number(1527775898123ULL + i * 999, 8));
+    }
+    all.push_back(dynamic);
+
+    //one value left to fds_drec2json per record, the others are covered
+    Case fallback = {"fallback", {
+            {0, 311, 8},                   //samplingProbability
+            {0, 276, 1},                   //dataRecordsReliability
+            {0, 4, 1},                     //protocolIdentifier
+            {0, 83, 8},                    //interfaceDescription (fixed)
+            {0, 82, FDS_IPFIX_VAR_IE_LEN}, //interfaceName
+    }, {}, true};
+    for (double value : nonFinite) {
+        fallback.records.push_back(Record()
+                .number(doubleBits(value), 8).number(1, 1).number(6, 1)
+                .raw("eth0/0/1").var("eth0"));
+    }
+    //invalid boolean
+    fallback.records.push_back(Record()
+            .number(doubleBits(0.5), 8).number(0, 1).number(6, 1)
+            .raw("eth0/0/1").var("eth0"));
+    //unnamed protocols (formatted by protocol only)
+    for (uint8_t protocol : {143, 200, 255}) {
+        fallback.records.push_back(Record()
+                .number(doubleBits(0.5), 8).number(1, 1)
+                .number(protocol, 1).raw("eth0/0/1").var("eth0"));
+    }
+    fallback.records.push_back(Record()
+            .number(doubleBits(0.5), 8).number(1, 1).number(6, 1)
+            .raw(std::string("a/\"b\\\n\0\0", 8)).var("eth0"));
+    for (const std::string &text : fallbackStrings()) {
+        fallback.records.push_back(Record()
+                .number(doubleBits(0.5), 8).number(1, 1).number(6, 1)
+                .raw("eth0/0/1").var(text));
+    }
+    all.push_back(fallback);
+
+    Case fallbackFloats = {"fallback float32", {
+            {0, 311, 4},   //samplingProbability (reduced size)
+    }, {}, true};
+    for (double value : nonFinite) {
+        fallbackFloats.records.push_back(
+                Record().number(floatBits(float(value)), 4));
+    }
+    all.push_back(fallbackFloats);
+
+    return all;
+}
+
+/**
+ * Compare conversion of the record by plan with fds_drec2json
+ * @return the record was converted by fds_drec2json (value fallback)
+ */
+bool compare(const Case &test, unsigned bits, const JsonConverter &converter,
+             const SharedTemplate *shared, Record &record, uint32_t flags,
+             BufferPool &pool, ConverterState &state) {
+    const char *name = test.name;
+    fds_drec rec = record.drec(shared);
+    OutputBuffer *buffer = pool.acquire();
+    const uint64_t fallbacks = state.valueFallbacks;
+    const int rc = converter.convert(shared, &rec, Records::iemgr(), buffer,
+                                     &state);
+    const bool fallback = state.valueFallbacks != fallbacks;
+
+    char *expected = nullptr;
+    size_t expectedSize = 0;
+    const int expectedRc = fds_drec2json(&rec, flags, Records::iemgr(),
+                                         &expected, &expectedSize);
+
+    const JsonPlan *plan = static_cast<const JsonPlan *>(shared->plan.get());
+    comparisons++;
+    if (plan == nullptr || plan->generic || plan->mismatch) {
+        failures++;
+        printf("FAIL %s (params %02x): record not converted by plan\n", name,
+               bits);
+    } else if (fallback && !test.fallback) {
+        failures++;
+        printf("FAIL %s (params %02x): value left to fds_drec2json\n", name,
+               bits);
+    } else if (rc != expectedRc || rc < 0 ||
+               memcmp(buffer->data, expected, rc) != 0) {
+        failures++;
+        printf("FAIL %s (params %02x)\n  plan:    %.*s\n  libfds:  %.*s\n",
+               name, bits, rc < 0 ? 0 : rc, buffer->data,
+               expectedRc < 0 ? 0 : expectedRc, expected);
+    }
+    free(expected);
+    pool.release(buffer);
+    return fallback;
+}
+
+/**
+ * Records of the case converted to compact records must keep the compact
+ * form, even if they are converted by fds_drec2json
+ */
+void checkCompact(Case &test, unsigned bits,
+                  const JsonConverter &converter, BufferPool &pool,
+                  ConverterState &state) {
+    std::shared_ptr<SharedTemplate> shared =
+            Records::makeTemplate(256, test.fields);
+    if (shared == nullptr) {
+        return;
+    }
+    for (Record &record : test.records) {
+        fds_drec rec = record.drec(shared.get());
+        OutputBuffer *buffer = pool.acquire();
+        const int rc = converter.convert(shared.get(), &rec,
+                                         Records::iemgr(), buffer, &state);
+        comparisons++;
+        if (rc < 2 || buffer->data[0] != '[' || buffer->data[rc - 1] != ']') {
+            failures++;
+            printf("FAIL %s compact (params %02x): %.*s\n", test.name, bits,
+                   rc < 0 ? 0 : rc, buffer->data);
+        }
+        pool.release(buffer);
+    }
+}
+
+} // namespace
+
+int main() {
+    if (Records::iemgr() == nullptr) {
+        return 1;
+    }
+
+    std::shared_ptr<ConfigProcessing> processing =
+            std::make_shared<ConfigProcessing>();
+    processing->compiledConversion = true;
+    //output of plans is compared here, not at runtime
+    processing->verifyConversion = 0;
+
+    //small buffers, records grow them
+    BufferPool pool(16, 32, 0);
+    ConverterState state;
+    std::vector<Case> all = cases();
+
+    //records of fallback cases converted by fds_drec2json, by case
+    std::vector<int> fallbacks(all.size());
+
+    for (unsigned bits = 0; bits < (1U << BITS); bits++) {
+        std::shared_ptr<ConfigFormat> format = makeFormat(bits);
+        const uint32_t flags = libfdsFlags(*format);
+        JsonConverter converter(format, processing);
+
+        for (size_t i = 0; i < all.size(); i++) {
+            Case &test = all[i];
+            //plans are kept in templates, each configuration has its own
+            std::shared_ptr<SharedTemplate> shared =
+                    Records::makeTemplate(256, test.fields);
+            if (shared == nullptr) {
+                failures++;
+                printf("FAIL %s: template not parsed\n", test.name);
+                continue;
+            }
+            for (Record &record : test.records) {
+                fallbacks[i] += compare(test, bits, converter, shared.get(),
+                                        record, flags, pool, state);
+            }
+        }
+    }
+
+    for (unsigned bits = 0; bits < (1U << BITS); bits++) {
+        std::shared_ptr<ConfigFormat> format = makeFormat(bits);
+        format->compact = true;
+        JsonConverter converter(format, processing);
+        for (Case &test : all) {
+            if (test.fallback) {
+                checkCompact(test, bits, converter, pool, state);
+            }
+        }
+    }
+
+    //fallback cases must exercise the fallback they are labelled with
+    for (size_t i = 0; i < all.size(); i++) {
+        if (!all[i].fallback) {
+            continue;
+        }
+        printf("%s: %d records converted by fds_drec2json\n", all[i].name,
+               fallbacks[i]);
+        if (fallbacks[i] == 0) {
+            failures++;
+            printf("FAIL %s: no record left to fds_drec2json\n",
+                   all[i].name);
+        }
+    }
+
+    printf("%d of %d records differ\n", failures, comparisons);
+    return failures == 0 ? 0 : 1;
+}
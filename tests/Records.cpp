@@ -0,0 +1,103 @@
+#include "Records.h"
+#include <cstdio>
+
+namespace {
+
+//enterprise bit of field ID in template record
+constexpr uint16_t EN_BIT = 0x8000;
+
+void appendUint(std::vector<uint8_t> &bytes, uint64_t value, size_t size) {
+    for (size_t i = size; i > 0; i--) {
+        bytes.push_back(uint8_t(value >> (8 * (i - 1))));
+    }
+}
+
+struct IemgrDeleter {
+    void operator()(fds_iemgr_t *mgr) const {
+        fds_iemgr_destroy(mgr);
+    }
+};
+
+} // namespace
+
+const fds_iemgr_t *Records::iemgr() {
+    static std::unique_ptr<fds_iemgr_t, IemgrDeleter> mgr(
+            [] {
+                fds_iemgr_t *created = fds_iemgr_create();
+                if (created == nullptr) {
+                    return created;
+                }
+                if (fds_iemgr_read_dir(created, fds_api_cfg_dir()) !=
+                    FDS_OK) {
+                    fprintf(stderr, "Failed to load IE definitions: %s\n",
+                            fds_iemgr_last_err(created));
+                    fds_iemgr_destroy(created);
+                    return static_cast<fds_iemgr_t *>(nullptr);
+                }
+                return created;
+            }());
+    return mgr.get();
+}
+
+std::shared_ptr<SharedTemplate>
+Records::makeTemplate(uint16_t id, const std::vector<Field> &fields,
+                      uint32_t odid) {
+    //template record: header and field specifiers
+    std::vector<uint8_t> raw;
+    appendUint(raw, id, 2);
+    appendUint(raw, fields.size(), 2);
+    for (const Field &field : fields) {
+        appendUint(raw, field.en != 0 ? field.id | EN_BIT : field.id, 2);
+        appendUint(raw, field.length, 2);
+        if (field.en != 0) {
+            appendUint(raw, field.en, 4);
+        }
+    }
+
+    fds_template *tmplt = nullptr;
+    uint16_t length = raw.size();
+    if (fds_template_parse(FDS_TYPE_TEMPLATE, raw.data(), &length,
+                           &tmplt) != FDS_OK) {
+        return nullptr;
+    }
+    if (iemgr() == nullptr ||
+        fds_template_ies_define(tmplt, iemgr(), false) != FDS_OK) {
+        fds_template_destroy(tmplt);
+        return nullptr;
+    }
+    //the shared template keeps its own copy
+    std::shared_ptr<SharedTemplate> shared =
+            std::make_shared<SharedTemplate>(tmplt, nullptr, odid);
+    fds_template_destroy(tmplt);
+    return shared;
+}
+
+Records::Record &Records::Record::number(uint64_t value, size_t size) {
+    appendUint(bytes, value, size);
+    return *this;
+}
+
+Records::Record &Records::Record::raw(const std::string &value) {
+    bytes.insert(bytes.end(), value.begin(), value.end());
+    return *this;
+}
+
+Records::Record &Records::Record::var(const std::string &value) {
+    //long values have 3-byte prefix (RFC 7011, 7.)
+    if (value.size() < 255) {
+        appendUint(bytes, value.size(), 1);
+    } else {
+        appendUint(bytes, 255, 1);
+        appendUint(bytes, value.size(), 2);
+    }
+    return raw(value);
+}
+
+fds_drec Records::Record::drec(const SharedTemplate *shared) {
+    fds_drec rec;
+    rec.data = bytes.data();
+    rec.size = bytes.size();
+    rec.tmplt = shared->tmplt;
+    rec.snap = nullptr;
+    return rec;
+}
@@ -0,0 +1,72 @@
+#ifndef RECORDS_H
+#define RECORDS_H
+
+#include <ipfixcol2.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TemplateCache.h"
+
+/**
+ * \brief Synthetic templates and records of tests and benchmarks
+ *
+ * Templates are parsed by libfds from raw template records and their fields
+ * are defined by the system IE manager, so records are converted exactly as
+ * records of the pipeline.
+ */
+namespace Records {
+
+/** Field of template */
+struct Field {
+    /** enterprise number                                                  */
+    uint32_t en;
+    /** ID of information element                                          */
+    uint16_t id;
+    /** length (FDS_IPFIX_VAR_IE_LEN - variable length)                    */
+    uint16_t length;
+};
+
+/**
+ * \brief IE manager with definitions of the libfds configuration directory
+ * @return manager (shared by all callers) or nullptr on error
+ */
+const fds_iemgr_t *iemgr();
+
+/**
+ * \brief Parse template and define its fields
+ * @param[in] id template ID
+ * @param[in] fields fields in order
+ * @param[in] odid observation domain ID
+ * @return template (file session) or nullptr on error
+ */
+std::shared_ptr<SharedTemplate> makeTemplate(uint16_t id,
+                                             const std::vector<Field> &fields,
+                                             uint32_t odid = 1);
+
+/**
+ * \brief Builder of raw data record, values are appended in template order
+ */
+class Record final {
+private:
+    std::vector<uint8_t> bytes;
+
+public:
+    /** Append unsigned integer (big endian) of the size */
+    Record &number(uint64_t value, size_t size);
+    /** Append raw bytes */
+    Record &raw(const std::string &value);
+    /** Append variable-length value with its length prefix */
+    Record &var(const std::string &value);
+
+    /**
+     * \brief Data record of the template
+     * @param[in] shared template of the record
+     * @return record referencing bytes of the builder
+     */
+    fds_drec drec(const SharedTemplate *shared);
+};
+
+} // namespace Records
+
+#endif // RECORDS_H